@@ -0,0 +1,100 @@
+project "RenderDaemon"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   targetdir "bin/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   files
+   {
+      "src/JobScheduler.h",
+      "src/JobScheduler.cpp",
+      "src/LocalSocket.h",
+      "src/LocalSocket.cpp",
+      "src/Daemon.cpp",
+
+      "../SimpleRayTracer/src/**.h",
+      "../SimpleRayTracer/src/**.cpp",
+   }
+
+   removefiles { "../SimpleRayTracer/src/RaytracerApp.cpp" }
+
+   includedirs
+   {
+      "../Walnut/vendor/imgui",
+      "../Walnut/vendor/glfw/include",
+      "../Walnut/vendor/glm",
+
+      "../Walnut/Walnut/src",
+      "../SimpleRayTracer/src",
+
+      "%{IncludeDir.VulkanSDK}",
+   }
+
+   links
+   {
+       "Walnut"
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+      defines { "WL_PLATFORM_WINDOWS" }
+      links { "Ws2_32" }
+
+   filter "configurations:Debug"
+      defines { "WL_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "WL_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "WL_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
+
+project "RenderClient"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   staticruntime "off"
+
+   files
+   {
+      "src/LocalSocket.h",
+      "src/LocalSocket.cpp",
+      "src/Client.cpp",
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+      defines { "WL_PLATFORM_WINDOWS" }
+      links { "Ws2_32" }
+
+   filter "configurations:Debug"
+      defines { "WL_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "WL_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "WL_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
@@ -0,0 +1,148 @@
+#include "LocalSocket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+*		Command line client for the render daemon
+*		* RenderClient [--socket <path>] [--scene <name|path>] [--width <w>] [--height <h>] [--spp <n>]
+*		*              [--priority <p>] [--camera <px>,<py>,<pz>,<dx>,<dy>,<dz>] [--views <n>] [--cache <0|1>]
+*		*              [--output <file.ppm>] [--count <n>]
+*		* Multiple views are written to one PPM, stacked vertically with view 0 at the bottom
+*		* RenderClient [--socket <path>] --stats
+*/
+
+namespace Utility
+{
+	static size_t FindValue(const std::string& response, const char* key)
+	{
+		std::string pattern = std::string(" ") + key + "=";
+		size_t position = response.find(pattern);
+		return position == std::string::npos ? 0 : strtoull(response.c_str() + position + pattern.size(), nullptr, 10);
+	}
+
+	static bool WritePPM(const std::string& path, const std::vector<uint32_t>& image, uint32_t width, uint32_t height)
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+
+		fprintf(file, "P6\n%u %u\n255\n", width, height);
+
+		// Rows come back bottom-up, as the viewport displays them flipped
+		std::vector<uint8_t> row(width * 3);
+		for (uint32_t y = height; y-- > 0;)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint32_t pixel = image[x + y * width];
+				row[x * 3 + 0] = pixel & 0xff;
+				row[x * 3 + 1] = (pixel >> 8) & 0xff;
+				row[x * 3 + 2] = (pixel >> 16) & 0xff;
+			}
+			fwrite(row.data(), 1, row.size(), file);
+		}
+
+		return fclose(file) == 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string socketPath = "raytracer.sock";
+	std::string output;
+	std::string request = "render";
+	uint32_t count = 1;
+	bool stats = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (argument == "--stats")
+			stats = true;
+		else if (argument == "--socket" && hasValue)
+			socketPath = argv[++i];
+		else if (argument == "--output" && hasValue)
+			output = argv[++i];
+		else if (argument == "--count" && hasValue)
+			count = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if ((argument == "--scene" || argument == "--width" || argument == "--height" || argument == "--spp" ||
+			argument == "--priority" || argument == "--camera" || argument == "--views" ||
+			argument == "--cache") && hasValue)
+			request += " " + argument.substr(2) + "=" + argv[++i];
+		else
+		{
+			fprintf(stderr, "Unknown or incomplete argument '%s'\n", argument.c_str());
+			return 1;
+		}
+	}
+
+	LocalSocket connection = LocalSocket::Connect(socketPath);
+	if (!connection.IsValid())
+	{
+		fprintf(stderr, "Could not connect to %s\n", socketPath.c_str());
+		return 1;
+	}
+
+	if (stats)
+	{
+		std::string response;
+		if (!connection.WriteLine("stats") || !connection.ReadLine(response))
+			return 1;
+
+		printf("%s\n", response.c_str());
+		return response.rfind("ok", 0) == 0 ? 0 : 1;
+	}
+
+	// Requests on one connection are served in order, so the images come back in order
+	std::vector<uint32_t> image;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		std::string response;
+		if (!connection.WriteLine(request) || !connection.ReadLine(response))
+		{
+			fprintf(stderr, "Connection lost\n");
+			return 1;
+		}
+
+		if (response.rfind("ok", 0) != 0)
+		{
+			fprintf(stderr, "%s\n", response.c_str());
+			return 1;
+		}
+
+		size_t bytes = Utility::FindValue(response, "bytes");
+		image.resize(bytes / sizeof(uint32_t));
+		if (!connection.Read(image.data(), bytes))
+		{
+			fprintf(stderr, "Connection lost\n");
+			return 1;
+		}
+
+		double roundTrip = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("%s round_trip_ms=%.2f\n", response.c_str() + 3, roundTrip);
+
+		if (!output.empty())
+		{
+			uint32_t width = (uint32_t)Utility::FindValue(response, "width");
+			uint32_t height = (uint32_t)Utility::FindValue(response, "height");
+			uint32_t views = std::max((uint32_t)Utility::FindValue(response, "views"), 1u);
+			if (!Utility::WritePPM(output, image, width, height * views))
+			{
+				fprintf(stderr, "Could not write %s\n", output.c_str());
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,222 @@
+#include "JobScheduler.h"
+#include "LocalSocket.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+
+/*
+*		Render daemon, one request per line on a local socket
+*		* render [scene=<name|path>] [width=<w>] [height=<h>] [spp=<n>] [priority=<p>] [camera=<px>,<py>,<pz>,<dx>,<dy>,<dz>] [views=<n>] [cache=<0|1>]
+*		*   -> ok job=<id> ... views=<n> rays=<n> bytes=<n>, followed by <n> bytes of RGBA8 pixels, one image after the other
+*		*   views > 1 renders a turntable: the camera orbits the y axis in equal steps, all views in one pass
+*		*   cache=1 ends paths at later diffuse bounces with cached radiance, rays counts every ray the job traced
+*		* stats
+*		*   -> ok jobs=<rendered> failed=<n> queued=<waiting now> preemptions=<n> uptime_s=<s> jobs_per_second=<r>
+*		* Failures answer with error <message>
+*/
+
+namespace Utility
+{
+	static bool ParseCamera(const std::string& value, RenderJobDescription& description)
+	{
+		glm::vec3& p = description.Position;
+		glm::vec3& d = description.Direction;
+		return sscanf(value.c_str(), "%f,%f,%f,%f,%f,%f", &p.x, &p.y, &p.z, &d.x, &d.y, &d.z) == 6;
+	}
+
+	static bool ParseCount(const std::string& value, uint32_t& count)
+	{
+		// Rejects what strtoul would otherwise wrap or truncate, the scheduler applies the actual limits
+		char* end = nullptr;
+		unsigned long long parsed = strtoull(value.c_str(), &end, 10);
+		if (value.empty() || value[0] == '-' || *end != '\0' || parsed > UINT32_MAX)
+			return false;
+
+		count = (uint32_t)parsed;
+		return true;
+	}
+
+	static bool ParseRenderRequest(std::istringstream& stream, RenderJobDescription& description, std::string& error)
+	{
+		std::string token;
+		while (stream >> token)
+		{
+			size_t separator = token.find('=');
+			if (separator == std::string::npos)
+			{
+				error = "expected key=value, got '" + token + "'";
+				return false;
+			}
+
+			std::string key = token.substr(0, separator);
+			std::string value = token.substr(separator + 1);
+
+			if (key == "scene")
+				description.Scene = value;
+			else if (key == "width" || key == "height" || key == "spp" || key == "views")
+			{
+				uint32_t& count = key == "width" ? description.Width : key == "height" ? description.Height :
+					key == "spp" ? description.SamplesPerPixel : description.ViewCount;
+				if (!ParseCount(value, count))
+				{
+					error = key + " expects an unsigned 32-bit integer, got '" + value + "'";
+					return false;
+				}
+			}
+			else if (key == "priority")
+				description.Priority = atoi(value.c_str());
+			else if (key == "cache")
+			{
+				if (value != "0" && value != "1")
+				{
+					error = "cache expects 0 or 1, got '" + value + "'";
+					return false;
+				}
+				description.CacheRadiance = value == "1";
+			}
+			else if (key == "camera")
+			{
+				if (!ParseCamera(value, description))
+				{
+					error = "camera expects six comma separated values";
+					return false;
+				}
+			}
+			else
+			{
+				error = "unknown key '" + key + "'";
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+static void HandleRender(JobScheduler& scheduler, LocalSocket& connection, std::istringstream& request)
+{
+	RenderJobDescription description;
+	std::string error;
+	if (!Utility::ParseRenderRequest(request, description, error))
+	{
+		connection.WriteLine("error " + error);
+		return;
+	}
+
+	std::shared_ptr<RenderJob> job = scheduler.Submit(description);
+	scheduler.Wait(job);
+
+	if (!job->Error.empty())
+	{
+		connection.WriteLine("error " + job->Error);
+		scheduler.Release(job);
+		return;
+	}
+
+	double queueMilliseconds = job->TotalMilliseconds - job->RenderMilliseconds;
+	size_t bytes = job->Image.size() * sizeof(uint32_t);
+
+	char header[320];
+	snprintf(header, sizeof(header), "ok job=%llu width=%u height=%u samples=%u queue_ms=%.2f render_ms=%.2f total_ms=%.2f preemptions=%u views=%u rays=%llu bytes=%zu",
+		(unsigned long long)job->Id, description.Width, description.Height, job->SamplesDone,
+		queueMilliseconds, job->RenderMilliseconds, job->TotalMilliseconds, job->Preemptions, description.ViewCount,
+		(unsigned long long)job->RaysTraced, bytes);
+
+	if (connection.WriteLine(header))
+		connection.Write(job->Image.data(), bytes);
+
+	scheduler.Release(job);
+}
+
+static void HandleStats(JobScheduler& scheduler, LocalSocket& connection)
+{
+	JobScheduler::Statistics statistics = scheduler.GetStatistics();
+	double jobsPerSecond = statistics.UptimeSeconds > 0.0 ? statistics.JobsCompleted / statistics.UptimeSeconds : 0.0;
+
+	char response[256];
+	snprintf(response, sizeof(response), "ok jobs=%llu failed=%llu queued=%llu preemptions=%llu uptime_s=%.2f jobs_per_second=%.2f",
+		(unsigned long long)statistics.JobsCompleted, (unsigned long long)statistics.JobsFailed, (unsigned long long)statistics.QueueDepth,
+		(unsigned long long)statistics.Preemptions, statistics.UptimeSeconds, jobsPerSecond);
+	connection.WriteLine(response);
+}
+
+static void ServeRequests(JobScheduler& scheduler, LocalSocket& connection)
+{
+	std::string line;
+	while (connection.ReadLine(line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		std::istringstream request(line);
+		std::string command;
+		request >> command;
+
+		if (command == "render")
+			HandleRender(scheduler, connection, request);
+		else if (command == "stats")
+			HandleStats(scheduler, connection);
+		else if (command == "quit")
+			break;
+		else if (!command.empty())
+			connection.WriteLine("error unknown command '" + command + "'");
+	}
+
+	if (connection.IsLineTooLong())
+	{
+		connection.WriteLine("error request line too long");
+	}
+}
+
+static void ServeConnection(JobScheduler& scheduler, LocalSocket connection)
+{
+	// Nothing a single client sends may end the daemon, an exception here would terminate it
+	try
+	{
+		ServeRequests(scheduler, connection);
+	}
+	catch (const std::exception&)
+	{
+		// Static text, building a message could fail the same way
+		static const char response[] = "error internal failure\n";
+		connection.Write(response, sizeof(response) - 1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string socketPath = argc > 1 ? argv[1] : "raytracer.sock";
+
+	std::string error;
+	LocalSocket listener = LocalSocket::Listen(socketPath, error);
+	if (!listener.IsValid())
+	{
+		fprintf(stderr, "Could not listen on %s: %s\n", socketPath.c_str(), error.c_str());
+		return 1;
+	}
+
+	printf("Render daemon listening on %s\n", socketPath.c_str());
+
+	JobScheduler scheduler;
+	while (true)
+	{
+		LocalSocket connection = listener.Accept();
+		if (!connection.IsValid())
+			continue;
+
+		// Connection threads only parse and wait, all tracing happens on the scheduler
+		try
+		{
+			std::thread(ServeConnection, std::ref(scheduler), std::move(connection)).detach();
+		}
+		catch (const std::system_error&)
+		{
+			// Out of threads, the connection is dropped and the daemon keeps accepting
+		}
+	}
+}
@@ -0,0 +1,301 @@
+#include "JobScheduler.h"
+#include "SceneLoader.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Utility
+{
+	static glm::vec3 RotateAroundY(const glm::vec3& vector, float angle)
+	{
+		float c = std::cos(angle), s = std::sin(angle);
+		return { c * vector.x + s * vector.z, vector.y, c * vector.z - s * vector.x };
+	}
+
+	static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+JobScheduler::JobScheduler()
+	: m_StartTime(std::chrono::steady_clock::now())
+{
+	m_Thread = std::thread(&JobScheduler::SchedulerThread, this);
+}
+
+JobScheduler::~JobScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_JobAvailable.notify_one();
+	m_Thread.join();
+}
+
+std::shared_ptr<RenderJob> JobScheduler::Submit(const RenderJobDescription& description)
+{
+	std::shared_ptr<RenderJob> job = std::make_shared<RenderJob>();
+	job->Description = description;
+	job->Submitted = std::chrono::steady_clock::now();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		job->Id = m_NextJobId++;
+		m_Queue.push_back(job);
+	}
+	m_JobAvailable.notify_one();
+
+	return job;
+}
+
+void JobScheduler::Wait(const std::shared_ptr<RenderJob>& job)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_JobFinished.wait(lock, [&job]() { return job->Done; });
+}
+
+void JobScheduler::Release(const std::shared_ptr<RenderJob>& job)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	ReleaseBuffer(m_ImagePool, std::move(job->Image));
+}
+
+JobScheduler::Statistics JobScheduler::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Statistics statistics = m_Statistics;
+	statistics.QueueDepth = m_Queue.size();
+	statistics.UptimeSeconds = Utility::MillisecondsSince(m_StartTime) / 1000.0;
+	return statistics;
+}
+
+void JobScheduler::SchedulerThread()
+{
+	while (true)
+	{
+		std::shared_ptr<RenderJob> job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobAvailable.wait(lock, [this]() { return !m_Queue.empty() || m_Stopping; });
+
+			if (m_Stopping)
+				return;
+
+			// Highest priority first, oldest first within a priority
+			auto next = std::min_element(m_Queue.begin(), m_Queue.end(), [](const std::shared_ptr<RenderJob>& a, const std::shared_ptr<RenderJob>& b)
+				{
+					return a->Description.Priority != b->Description.Priority ? a->Description.Priority > b->Description.Priority : a->Id < b->Id;
+				});
+			job = *next;
+			m_Queue.erase(next);
+		}
+
+		// An allocation failure ends this job only, not the daemon and everything queued behind it
+		try
+		{
+			RunJob(job);
+		}
+		catch (const std::exception& exception)
+		{
+			job->Error = std::string("render failed: ") + exception.what();
+			Complete(*job);
+		}
+	}
+}
+
+void JobScheduler::RunJob(const std::shared_ptr<RenderJob>& job)
+{
+	// Preempted jobs resume with their accumulation intact
+	if (job->SamplesDone == 0 && !PrepareJob(*job))
+	{
+		Complete(*job);
+		return;
+	}
+
+	const RenderJobDescription& description = job->Description;
+	const size_t pixelCount = (size_t)description.Width * description.Height;
+
+	// Every view of the job shares one tile queue
+	std::vector<Renderer::ViewTarget> views(description.ViewCount);
+	for (uint32_t i = 0; i < description.ViewCount; i++)
+	{
+		views[i].ViewCamera = &job->JobCameras[i];
+		views[i].Width = description.Width;
+		views[i].Height = description.Height;
+		views[i].Accumulation = job->Accumulation.data() + i * pixelCount;
+	}
+
+	while (job->SamplesDone < description.SamplesPerPixel)
+	{
+		uint32_t sampleCount = std::min(SamplesPerSlice, description.SamplesPerPixel - job->SamplesDone);
+		bool lastSlice = job->SamplesDone + sampleCount == description.SamplesPerPixel;
+
+		for (uint32_t i = 0; i < description.ViewCount; i++)
+		{
+			views[i].Image = lastSlice ? job->Image.data() + i * pixelCount : nullptr;
+		}
+
+		// Set per slice, a preempting job may have switched it
+		m_Renderer.GetSettings().CacheRadiance = description.CacheRadiance;
+
+		auto sliceStart = std::chrono::steady_clock::now();
+		m_Renderer.RenderViews(*job->JobScene, views.data(), description.ViewCount, job->SamplesDone, sampleCount);
+		job->RenderMilliseconds += Utility::MillisecondsSince(sliceStart);
+		job->RaysTraced += m_Renderer.GetTraceStatistics().RaysTraced;
+		job->SamplesDone += sampleCount;
+
+		if (!lastSlice && HasHigherPriorityJob(description.Priority))
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			job->Preemptions++;
+			m_Statistics.Preemptions++;
+			m_Queue.push_back(job);
+			return;
+		}
+	}
+
+	Complete(*job);
+}
+
+bool JobScheduler::PrepareJob(RenderJob& job)
+{
+	RenderJobDescription& description = job.Description;
+	if (description.Width == 0 || description.Height == 0 || description.SamplesPerPixel == 0 || description.ViewCount == 0)
+	{
+		job.Error = "width, height, spp and views must be positive";
+		return false;
+	}
+
+	// Clients are untrusted, bound what one request can allocate and how long it can hold the renderer
+	if (description.ViewCount > MaxViewCount)
+	{
+		job.Error = "views must be at most " + std::to_string(MaxViewCount);
+		return false;
+	}
+	if (description.Width > MaxImageSize || description.Height > MaxImageSize || (uint64_t)description.Width * description.Height * description.ViewCount > MaxPixelCount)
+	{
+		job.Error = "image too large, at most " + std::to_string(MaxPixelCount) + " pixels over all views and " + std::to_string(MaxImageSize) + " per side";
+		return false;
+	}
+	if (description.SamplesPerPixel > MaxSamplesPerPixel)
+	{
+		job.Error = "spp must be at most " + std::to_string(MaxSamplesPerPixel);
+		return false;
+	}
+
+	job.JobScene = GetScene(description.Scene, job.Error);
+	if (!job.JobScene)
+		return false;
+
+	// Turntable around the y axis, view 0 is the requested camera
+	job.JobCameras.assign(description.ViewCount, Camera(45.0f, 0.1f, 100.0f));
+	for (uint32_t i = 0; i < description.ViewCount; i++)
+	{
+		float angle = 2.0f * 3.14159265f * (float)i / (float)description.ViewCount;
+		job.JobCameras[i].SetPose(Utility::RotateAroundY(description.Position, angle), Utility::RotateAroundY(description.Direction, angle));
+	}
+	job.Started = std::chrono::steady_clock::now();
+
+	// Entries left by earlier jobs would make the image depend on what ran before
+	if (description.CacheRadiance)
+		m_Renderer.ResetFrameCount();
+
+	size_t pixelCount = (size_t)description.Width * description.Height * description.ViewCount;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	job.Accumulation = AcquireBuffer(m_AccumulationPool, pixelCount);
+	job.Image = AcquireBuffer(m_ImagePool, pixelCount);
+	std::fill(job.Accumulation.begin(), job.Accumulation.end(), glm::vec4(0.0f));
+
+	return true;
+}
+
+bool JobScheduler::HasHigherPriorityJob(int priority)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return std::any_of(m_Queue.begin(), m_Queue.end(), [priority](const std::shared_ptr<RenderJob>& job) { return job->Description.Priority > priority; });
+}
+
+void JobScheduler::Complete(RenderJob& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		ReleaseBuffer(m_AccumulationPool, std::move(job.Accumulation));
+
+		job.TotalMilliseconds = Utility::MillisecondsSince(job.Submitted);
+		job.Done = true;
+
+		// Only finished renders count towards throughput
+		if (job.Error.empty())
+			m_Statistics.JobsCompleted++;
+		else
+			m_Statistics.JobsFailed++;
+	}
+	m_JobFinished.notify_all();
+}
+
+std::shared_ptr<const Scene> JobScheduler::GetScene(const std::string& name, std::string& error)
+{
+	// Only the scheduler thread touches the cache
+	auto cached = m_Scenes.find(name);
+	if (cached != m_Scenes.end())
+		return cached->second;
+
+	std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+	if (name == "default")
+	{
+		*scene = SceneLoader::CreateDefaultScene();
+	}
+	else if (!SceneLoader::LoadFromFile(name, *scene, error))
+	{
+		return nullptr;
+	}
+
+	m_Scenes[name] = scene;
+	return scene;
+}
+
+template<typename T>
+std::vector<T> JobScheduler::AcquireBuffer(std::vector<std::vector<T>>& pool, size_t size)
+{
+	// Smallest pooled buffer that fits without reallocating, otherwise the largest one
+	auto best = pool.end();
+	for (auto it = pool.begin(); it != pool.end(); it++)
+	{
+		if (it->capacity() >= size && (best == pool.end() || best->capacity() < size || it->capacity() < best->capacity()))
+			best = it;
+	}
+	if (best == pool.end())
+	{
+		best = std::max_element(pool.begin(), pool.end(), [](const std::vector<T>& a, const std::vector<T>& b) { return a.capacity() < b.capacity(); });
+	}
+
+	std::vector<T> buffer;
+	if (best != pool.end())
+	{
+		buffer = std::move(*best);
+		pool.erase(best);
+	}
+
+	buffer.resize(size);
+	return buffer;
+}
+
+template<typename T>
+void JobScheduler::ReleaseBuffer(std::vector<std::vector<T>>& pool, std::vector<T>&& buffer)
+{
+	if (buffer.capacity() == 0)
+		return;
+
+	pool.push_back(std::move(buffer));
+	buffer = std::vector<T>();
+
+	// Drop the smallest buffers beyond the pool limit
+	if (pool.size() > MaxPooledBuffers)
+	{
+		auto smallest = std::min_element(pool.begin(), pool.end(), [](const std::vector<T>& a, const std::vector<T>& b) { return a.capacity() < b.capacity(); });
+		pool.erase(smallest);
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Camera.h"
+#include "Scene.h"
+
+#include <glm/glm.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct RenderJobDescription
+{
+	std::string Scene = "default"; // "default" or a scene file path
+	glm::vec3 Position{ 0.0f, 0.0f, 6.0f };
+	glm::vec3 Direction{ 0.0f, 0.0f, -1.0f };
+	uint32_t Width = 256, Height = 256;
+	uint32_t SamplesPerPixel = 16;
+	int Priority = 0; // Higher runs first and preempts lower
+	uint32_t ViewCount = 1; // Views orbit the y axis in equal steps, starting at Position
+	bool CacheRadiance = false; // See Renderer::Settings, the job starts from an empty cache
+};
+
+struct RenderJob
+{
+	uint64_t Id = 0;
+	RenderJobDescription Description;
+
+	// Filled in by the scheduler
+	std::shared_ptr<const Scene> JobScene;
+	std::vector<Camera> JobCameras; // One per view
+	std::vector<glm::vec4> Accumulation;
+	std::vector<uint32_t> Image; // RGBA per view, one after the other, valid once Done
+
+	uint32_t SamplesDone = 0;
+	uint32_t Preemptions = 0;
+	uint64_t RaysTraced = 0;
+
+	std::chrono::steady_clock::time_point Submitted;
+	std::chrono::steady_clock::time_point Started;
+	double RenderMilliseconds = 0.0;
+	double TotalMilliseconds = 0.0;
+
+	bool Done = false;
+	std::string Error;
+};
+
+/*
+*		Runs render jobs one at a time on the shared parallel pool
+*		* Jobs advance in slices of SamplesPerSlice, after each slice a waiting job with
+*		* a higher priority preempts the current one (its accumulation is kept)
+*		* Scenes are loaded once and cached, accumulation and image buffers are pooled
+*/
+
+class JobScheduler
+{
+public:
+	struct Statistics
+	{
+		uint64_t JobsCompleted = 0; // Rendered and returned
+		uint64_t JobsFailed = 0; // Rejected requests and render failures
+		uint64_t QueueDepth = 0; // Waiting right now, excluding the running job
+		uint64_t Preemptions = 0;
+		double UptimeSeconds = 0.0;
+	};
+
+public:
+	JobScheduler();
+	~JobScheduler();
+
+	std::shared_ptr<RenderJob> Submit(const RenderJobDescription& description);
+	void Wait(const std::shared_ptr<RenderJob>& job);
+
+	// Returns the job's buffers to the pools once its result has been sent
+	void Release(const std::shared_ptr<RenderJob>& job);
+
+	Statistics GetStatistics();
+
+private:
+	void SchedulerThread();
+	void RunJob(const std::shared_ptr<RenderJob>& job);
+	bool PrepareJob(RenderJob& job);
+	bool HasHigherPriorityJob(int priority);
+	void Complete(RenderJob& job);
+
+	std::shared_ptr<const Scene> GetScene(const std::string& name, std::string& error);
+
+	template<typename T>
+	static std::vector<T> AcquireBuffer(std::vector<std::vector<T>>& pool, size_t size);
+	template<typename T>
+	static void ReleaseBuffer(std::vector<std::vector<T>>& pool, std::vector<T>&& buffer);
+
+private:
+	static constexpr uint32_t SamplesPerSlice = 4;
+	static constexpr uint32_t MaxImageSize = 8192;
+	static constexpr uint64_t MaxPixelCount = 4096 * 4096; // 256 MB of accumulation
+	static constexpr uint32_t MaxSamplesPerPixel = 16384;
+	static constexpr uint32_t MaxViewCount = 1024;
+
+	Renderer m_Renderer;
+
+	std::vector<std::shared_ptr<RenderJob>> m_Queue;
+	uint64_t m_NextJobId = 1;
+	bool m_Stopping = false;
+
+	std::unordered_map<std::string, std::shared_ptr<const Scene>> m_Scenes;
+
+	// Buffers are moved into jobs and back, so their allocations survive between jobs
+	static constexpr size_t MaxPooledBuffers = 8;
+	std::vector<std::vector<glm::vec4>> m_AccumulationPool;
+	std::vector<std::vector<uint32_t>> m_ImagePool;
+
+	Statistics m_Statistics;
+	std::chrono::steady_clock::time_point m_StartTime;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_JobAvailable;
+	std::condition_variable m_JobFinished;
+	std::thread m_Thread;
+};
@@ -0,0 +1,242 @@
+#include "LocalSocket.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#ifdef WL_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <WinSock2.h>
+	#include <afunix.h>
+
+	using NativeSocket = SOCKET;
+	using SocketLength = int;
+	static constexpr int SendFlags = 0;
+	static void CloseNativeSocket(intptr_t handle) { closesocket((SOCKET)handle); }
+#else
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+
+	using NativeSocket = int;
+	using SocketLength = socklen_t;
+	#ifdef MSG_NOSIGNAL
+		static constexpr int SendFlags = MSG_NOSIGNAL; // A vanished client must not kill the daemon
+	#else
+		static constexpr int SendFlags = 0;
+	#endif
+	static void CloseNativeSocket(intptr_t handle) { close((int)handle); }
+#endif
+
+namespace Utility
+{
+	static bool InitializeSockets()
+	{
+#ifdef WL_PLATFORM_WINDOWS
+		static bool initialized = []()
+			{
+				WSADATA data;
+				return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+			}();
+		return initialized;
+#else
+		return true;
+#endif
+	}
+
+	static bool MakeAddress(const std::string& path, sockaddr_un& address)
+	{
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+			return false;
+
+		memcpy(address.sun_path, path.c_str(), path.size());
+		return true;
+	}
+
+	static intptr_t CreateSocket()
+	{
+		if (!InitializeSockets())
+			return -1;
+
+		return (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+	}
+}
+
+LocalSocket::~LocalSocket()
+{
+	Close();
+}
+
+LocalSocket::LocalSocket(LocalSocket&& other) noexcept
+	: m_Handle(other.m_Handle), m_Buffer(std::move(other.m_Buffer)), m_LineTooLong(other.m_LineTooLong)
+{
+	other.m_Handle = InvalidHandle;
+}
+
+LocalSocket& LocalSocket::operator=(LocalSocket&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_Handle = other.m_Handle;
+		m_Buffer = std::move(other.m_Buffer);
+		m_LineTooLong = other.m_LineTooLong;
+		other.m_Handle = InvalidHandle;
+	}
+	return *this;
+}
+
+LocalSocket LocalSocket::Listen(const std::string& path, std::string& error)
+{
+	sockaddr_un address;
+	if (!Utility::MakeAddress(path, address))
+	{
+		error = "socket path is too long";
+		return LocalSocket();
+	}
+
+	LocalSocket listener(Utility::CreateSocket());
+	if (!listener.IsValid())
+	{
+		error = "could not create a socket";
+		return LocalSocket();
+	}
+
+	// Only a socket file left behind by a daemon that is gone is replaced, never a regular
+	// file (a mistyped argument) and never the socket of a daemon that still answers
+	std::error_code statusError;
+	std::filesystem::file_status status = std::filesystem::symlink_status(path, statusError);
+	if (std::filesystem::exists(status))
+	{
+		if (!std::filesystem::is_socket(status))
+		{
+			error = "path exists and is not a socket";
+			return LocalSocket();
+		}
+
+		if (Connect(path).IsValid())
+		{
+			error = "another daemon is listening on it";
+			return LocalSocket();
+		}
+
+		std::filesystem::remove(path, statusError);
+	}
+
+	if (bind((NativeSocket)listener.m_Handle, (const sockaddr*)&address, (SocketLength)sizeof(address)) != 0 ||
+		listen((NativeSocket)listener.m_Handle, SOMAXCONN) != 0)
+	{
+		error = "could not bind the socket";
+		return LocalSocket();
+	}
+
+	return listener;
+}
+
+LocalSocket LocalSocket::Connect(const std::string& path)
+{
+	sockaddr_un address;
+	if (!Utility::MakeAddress(path, address))
+		return LocalSocket();
+
+	LocalSocket connection(Utility::CreateSocket());
+	if (!connection.IsValid())
+		return LocalSocket();
+
+	if (connect((NativeSocket)connection.m_Handle, (const sockaddr*)&address, (SocketLength)sizeof(address)) != 0)
+		return LocalSocket();
+
+	return connection;
+}
+
+LocalSocket LocalSocket::Accept()
+{
+	return LocalSocket((intptr_t)accept((NativeSocket)m_Handle, nullptr, nullptr));
+}
+
+void LocalSocket::Close()
+{
+	if (IsValid())
+	{
+		CloseNativeSocket(m_Handle);
+	}
+	m_Handle = InvalidHandle;
+	m_Buffer.clear();
+	m_LineTooLong = false;
+}
+
+bool LocalSocket::ReadLine(std::string& line)
+{
+	char chunk[4096];
+	size_t end;
+	while ((end = m_Buffer.find('\n')) == std::string::npos)
+	{
+		// A peer that never sends a newline must not grow the buffer without bound
+		if (m_Buffer.size() > MaxLineLength)
+		{
+			m_LineTooLong = true;
+			return false;
+		}
+
+		int received = (int)recv((NativeSocket)m_Handle, chunk, sizeof(chunk), 0);
+		if (received <= 0)
+			return false;
+
+		m_Buffer.append(chunk, received);
+	}
+
+	if (end > MaxLineLength)
+	{
+		m_LineTooLong = true;
+		return false;
+	}
+
+	line = m_Buffer.substr(0, end);
+	m_Buffer.erase(0, end + 1);
+	return true;
+}
+
+bool LocalSocket::Read(void* data, size_t size)
+{
+	uint8_t* destination = (uint8_t*)data;
+
+	// Drain what ReadLine already pulled off the socket
+	size_t buffered = std::min(size, m_Buffer.size());
+	memcpy(destination, m_Buffer.data(), buffered);
+	m_Buffer.erase(0, buffered);
+
+	for (size_t offset = buffered; offset < size;)
+	{
+		int received = (int)recv((NativeSocket)m_Handle, (char*)destination + offset, (int)std::min<size_t>(size - offset, 1 << 30), 0);
+		if (received <= 0)
+			return false;
+
+		offset += received;
+	}
+
+	return true;
+}
+
+bool LocalSocket::Write(const void* data, size_t size)
+{
+	const char* source = (const char*)data;
+	for (size_t offset = 0; offset < size;)
+	{
+		int sent = (int)send((NativeSocket)m_Handle, source + offset, (int)std::min<size_t>(size - offset, 1 << 30), SendFlags);
+		if (sent <= 0)
+			return false;
+
+		offset += sent;
+	}
+
+	return true;
+}
+
+bool LocalSocket::WriteLine(const std::string& line)
+{
+	std::string terminated = line + "\n";
+	return Write(terminated.data(), terminated.size());
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Stream socket on a Unix domain socket path (AF_UNIX, also available on Windows 10+)
+class LocalSocket
+{
+public:
+	LocalSocket() = default;
+	~LocalSocket();
+
+	LocalSocket(LocalSocket&& other) noexcept;
+	LocalSocket& operator=(LocalSocket&& other) noexcept;
+	LocalSocket(const LocalSocket&) = delete;
+	LocalSocket& operator=(const LocalSocket&) = delete;
+
+	// Fails instead of replacing anything at path other than a stale socket
+	static LocalSocket Listen(const std::string& path, std::string& error);
+	static LocalSocket Connect(const std::string& path);
+
+	LocalSocket Accept();
+	void Close();
+
+	// Reads up to and excluding '\n', fails on lines longer than MaxLineLength
+	bool ReadLine(std::string& line);
+	bool IsLineTooLong() const { return m_LineTooLong; }
+	bool Read(void* data, size_t size);
+	bool Write(const void* data, size_t size);
+	bool WriteLine(const std::string& line);
+
+	bool IsValid() const { return m_Handle != InvalidHandle; }
+
+private:
+	explicit LocalSocket(intptr_t handle) : m_Handle(handle) {}
+
+private:
+	static constexpr intptr_t InvalidHandle = -1;
+	static constexpr size_t MaxLineLength = 4096;
+	intptr_t m_Handle = InvalidHandle;
+
+	// Bytes received past the last line
+	std::string m_Buffer;
+	bool m_LineTooLong = false;
+};
@@ -0,0 +1,194 @@
+#include "BSDF.h"
+#include "Scene.h"
+
+#include <cmath>
+
+namespace Utility
+{
+	constexpr float Pi = 3.14159265358979f;
+	constexpr float MinAlpha = 1e-3f; // Keeps roughness 0 numerically stable (near mirror)
+	constexpr float MinCosine = 1e-4f;
+
+	static float Luminance(const glm::vec3& color)
+	{
+		return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	}
+
+	/*
+	*		Branchless orthonormal basis
+	*		* https://jcgt.org/published/0006/01/01/
+	*/
+	static void BuildBasis(const glm::vec3& normal, glm::vec3& tangent, glm::vec3& bitangent)
+	{
+		float sign = std::copysign(1.0f, normal.z);
+		float a = -1.0f / (sign + normal.z);
+		float b = normal.x * normal.y * a;
+		tangent = glm::vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+		bitangent = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
+	}
+
+	struct Frame
+	{
+		glm::vec3 Tangent, Bitangent, Normal;
+
+		glm::vec3 ToLocal(const glm::vec3& v) const { return { glm::dot(v, Tangent), glm::dot(v, Bitangent), glm::dot(v, Normal) }; }
+		glm::vec3 ToWorld(const glm::vec3& v) const { return Tangent * v.x + Bitangent * v.y + Normal * v.z; }
+	};
+
+	static Frame MakeFrame(const glm::vec3& normal)
+	{
+		Frame frame;
+		frame.Normal = normal;
+		BuildBasis(normal, frame.Tangent, frame.Bitangent);
+		return frame;
+	}
+
+	static glm::vec3 FresnelSchlick(const glm::vec3& f0, float cosTheta)
+	{
+		float m = glm::clamp(1.0f - cosTheta, 0.0f, 1.0f);
+		float m2 = m * m;
+		return f0 + (glm::vec3(1.0f) - f0) * (m2 * m2 * m);
+	}
+
+	static float DistributionGGX(float cosThetaH, float alpha2)
+	{
+		float d = cosThetaH * cosThetaH * (alpha2 - 1.0f) + 1.0f;
+		return alpha2 / (Pi * d * d);
+	}
+
+	static float SmithG1(float cosTheta, float alpha2)
+	{
+		return 2.0f * cosTheta / (cosTheta + std::sqrt(alpha2 + (1.0f - alpha2) * cosTheta * cosTheta));
+	}
+
+	// Visible normal sampling in the local frame (z = normal)
+	static glm::vec3 SampleVisibleNormal(const glm::vec3& outgoing, float alpha, float u1, float u2)
+	{
+		// Stretch the view vector to the hemisphere configuration
+		glm::vec3 vh = glm::normalize(glm::vec3(alpha * outgoing.x, alpha * outgoing.y, outgoing.z));
+
+		float lengthSquared = vh.x * vh.x + vh.y * vh.y;
+		glm::vec3 t1 = lengthSquared > 0.0f ? glm::vec3(-vh.y, vh.x, 0.0f) / std::sqrt(lengthSquared) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 t2 = glm::cross(vh, t1);
+
+		// Sample the projected disk
+		float r = std::sqrt(u1);
+		float phi = 2.0f * Pi * u2;
+		float p1 = r * std::cos(phi);
+		float p2 = r * std::sin(phi);
+		float s = 0.5f * (1.0f + vh.z);
+		p2 = (1.0f - s) * std::sqrt(1.0f - p1 * p1) + s * p2;
+
+		// Reproject onto the hemisphere and unstretch
+		glm::vec3 nh = t1 * p1 + t2 * p2 + vh * std::sqrt(glm::max(0.0f, 1.0f - p1 * p1 - p2 * p2));
+		return glm::normalize(glm::vec3(alpha * nh.x, alpha * nh.y, glm::max(0.0f, nh.z)));
+	}
+
+	static glm::vec3 SampleCosineHemisphere(float u1, float u2)
+	{
+		float r = std::sqrt(u1);
+		float phi = 2.0f * Pi * u2;
+		return { r * std::cos(phi), r * std::sin(phi), std::sqrt(glm::max(0.0f, 1.0f - u1)) };
+	}
+
+	// Shading terms shared by sampling, evaluation and pdf
+	struct Lobes
+	{
+		glm::vec3 F0;
+		glm::vec3 DiffuseColor;
+		float Alpha;
+		float Alpha2;
+		float SpecularProbability;
+	};
+
+	static Lobes MakeLobes(const Material& material, float cosThetaO)
+	{
+		Lobes lobes;
+		lobes.F0 = glm::mix(glm::vec3(0.04f), material.Albedo, material.Metallic);
+		lobes.DiffuseColor = material.Albedo * (1.0f - material.Metallic);
+		lobes.Alpha = glm::max(material.Roughness * material.Roughness, MinAlpha);
+		lobes.Alpha2 = lobes.Alpha * lobes.Alpha;
+
+		// Pick lobes proportionally to their expected contribution
+		float specular = Luminance(FresnelSchlick(lobes.F0, cosThetaO));
+		float diffuse = Luminance(lobes.DiffuseColor) * (1.0f - specular);
+		float total = specular + diffuse;
+		lobes.SpecularProbability = total > 0.0f ? specular / total : 1.0f;
+
+		return lobes;
+	}
+
+	static glm::vec3 EvaluateLocal(const Lobes& lobes, const glm::vec3& wo, const glm::vec3& wi)
+	{
+		if (wi.z <= 0.0f)
+			return glm::vec3(0.0f);
+
+		glm::vec3 h = glm::normalize(wo + wi);
+		glm::vec3 fresnel = FresnelSchlick(lobes.F0, glm::dot(wo, h));
+
+		float d = DistributionGGX(h.z, lobes.Alpha2);
+		float g = SmithG1(wo.z, lobes.Alpha2) * SmithG1(wi.z, lobes.Alpha2);
+		glm::vec3 specular = fresnel * (d * g / (4.0f * wo.z * wi.z));
+		glm::vec3 diffuse = (glm::vec3(1.0f) - fresnel) * lobes.DiffuseColor / Pi;
+
+		return specular + diffuse;
+	}
+
+	static float PdfLocal(const Lobes& lobes, const glm::vec3& wo, const glm::vec3& wi)
+	{
+		if (wi.z <= 0.0f)
+			return 0.0f;
+
+		glm::vec3 h = glm::normalize(wo + wi);
+
+		// pdf(wi) = G1(wo) * D(h) / (4 * cos(wo))
+		float specularPdf = SmithG1(wo.z, lobes.Alpha2) * DistributionGGX(h.z, lobes.Alpha2) / (4.0f * wo.z);
+		float diffusePdf = wi.z / Pi;
+
+		return glm::mix(diffusePdf, specularPdf, lobes.SpecularProbability);
+	}
+}
+
+BSDF::Sample BSDF::SampleMaterial(const Material& material, const glm::vec3& normal, const glm::vec3& outgoing, const glm::vec3& random)
+{
+	Utility::Frame frame = Utility::MakeFrame(normal);
+	glm::vec3 wo = frame.ToLocal(outgoing);
+	wo.z = glm::max(wo.z, Utility::MinCosine);
+
+	Utility::Lobes lobes = Utility::MakeLobes(material, wo.z);
+
+	glm::vec3 wi;
+	if (random.z < lobes.SpecularProbability)
+	{
+		glm::vec3 h = Utility::SampleVisibleNormal(wo, lobes.Alpha, random.x, random.y);
+		wi = glm::reflect(-wo, h);
+	}
+	else
+	{
+		wi = Utility::SampleCosineHemisphere(random.x, random.y);
+	}
+
+	BSDF::Sample sample;
+	sample.Direction = frame.ToWorld(wi);
+	sample.Pdf = Utility::PdfLocal(lobes, wo, wi);
+	sample.Value = Utility::EvaluateLocal(lobes, wo, wi);
+	return sample;
+}
+
+glm::vec3 BSDF::Evaluate(const Material& material, const glm::vec3& normal, const glm::vec3& outgoing, const glm::vec3& incoming)
+{
+	Utility::Frame frame = Utility::MakeFrame(normal);
+	glm::vec3 wo = frame.ToLocal(outgoing);
+	wo.z = glm::max(wo.z, Utility::MinCosine);
+
+	return Utility::EvaluateLocal(Utility::MakeLobes(material, wo.z), wo, frame.ToLocal(incoming));
+}
+
+float BSDF::Pdf(const Material& material, const glm::vec3& normal, const glm::vec3& outgoing, const glm::vec3& incoming)
+{
+	Utility::Frame frame = Utility::MakeFrame(normal);
+	glm::vec3 wo = frame.ToLocal(outgoing);
+	wo.z = glm::max(wo.z, Utility::MinCosine);
+
+	return Utility::PdfLocal(Utility::MakeLobes(material, wo.z), wo, frame.ToLocal(incoming));
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct Material;
+
+/*
+*		Metallic/Roughness BSDF
+*		* Lambertian diffuse lobe + GGX specular lobe, blended with Schlick Fresnel
+*		* Specular directions are drawn from the GGX distribution of visible normals
+*		* https://jcgt.org/published/0007/04/01/
+*/
+
+namespace BSDF
+{
+	struct Sample
+	{
+		glm::vec3 Direction{ 0.0f }; // Sampled incoming direction (world space)
+		glm::vec3 Value{ 0.0f }; // BSDF value f(outgoing, incoming)
+		float Pdf = 0.0f; // Solid angle pdf of Direction (0 = invalid sample)
+	};
+
+	// outgoing points away from the surface (towards the previous path vertex)
+	// random holds three uniform numbers in [0, 1)
+	Sample SampleMaterial(const Material& material, const glm::vec3& normal, const glm::vec3& outgoing, const glm::vec3& random);
+	glm::vec3 Evaluate(const Material& material, const glm::vec3& normal, const glm::vec3& outgoing, const glm::vec3& incoming);
+	float Pdf(const Material& material, const glm::vec3& normal, const glm::vec3& outgoing, const glm::vec3& incoming);
+}
@@ -104,6 +104,15 @@ void Camera::OnResize(uint32_t width, uint32_t height)
 	RecalculateRayDirections();
 }
 
+void Camera::SetPose(const glm::vec3& position, const glm::vec3& forwardDirection)
+{
+	m_Position = position;
+	m_ForwardDirection = glm::normalize(forwardDirection);
+
+	RecalculateView();
+	RecalculateRayDirections();
+}
+
 float Camera::GetRotationSpeed()
 {
 	return 0.3f;
@@ -129,13 +138,22 @@ void Camera::RecalculateRayDirections()
 	{
 		for (uint32_t x = 0; x < m_ViewportWidth; x++)
 		{
-			// Calculate the coordinate of the pixel in the range [0, 1]
-			glm::vec2 coordinate = { (float)x / (float)m_ViewportWidth, (float)y / (float)m_ViewportHeight };
-			coordinate = coordinate * 2.0f - 1.0f; // Scale to [-1, 1]
-
-			glm::vec4 target = m_InverseProjection * glm::vec4(coordinate.x, coordinate.y, 1, 1);
-			glm::vec3 rayDirection = glm::vec3(m_InverseView * glm::vec4(glm::normalize(glm::vec3(target) / target.w), 0)); // World space
-			m_RayDirections[x + y * m_ViewportWidth] = rayDirection;
+			m_RayDirections[x + y * m_ViewportWidth] = CalculateRayDirection(m_InverseProjection, x, y, m_ViewportWidth, m_ViewportHeight);
 		}
 	}
+}
+
+glm::mat4 Camera::CalculateInverseProjection(uint32_t width, uint32_t height) const
+{
+	return glm::inverse(glm::perspectiveFov(glm::radians(m_VerticalFOV), (float)width, (float)height, m_NearClip, m_FarClip));
+}
+
+glm::vec3 Camera::CalculateRayDirection(const glm::mat4& inverseProjection, uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+{
+	// Calculate the coordinate of the pixel in the range [0, 1]
+	glm::vec2 coordinate = { (float)x / (float)width, (float)y / (float)height };
+	coordinate = coordinate * 2.0f - 1.0f; // Scale to [-1, 1]
+
+	glm::vec4 target = inverseProjection * glm::vec4(coordinate.x, coordinate.y, 1, 1);
+	return glm::vec3(m_InverseView * glm::vec4(glm::normalize(glm::vec3(target) / target.w), 0)); // World space
 }
\ No newline at end of file
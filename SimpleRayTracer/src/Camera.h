@@ -11,6 +11,14 @@ public:
 	bool OnUpdate(float deltaTime);
 	void OnResize(uint32_t width, uint32_t height);
 
+	// Ray directions are only cached for the viewport size, on a camera that was never resized
+	// (headless rendering) this only updates the view
+	void SetPose(const glm::vec3& position, const glm::vec3& forwardDirection);
+
+	// Ray generation at an arbitrary resolution (offline rendering)
+	glm::mat4 CalculateInverseProjection(uint32_t width, uint32_t height) const;
+	glm::vec3 CalculateRayDirection(const glm::mat4& inverseProjection, uint32_t x, uint32_t y, uint32_t width, uint32_t height) const;
+
 private:
 	void RecalculateProjection();
 	void RecalculateView();
@@ -41,6 +49,10 @@ public:
 	const glm::mat4& GetView() const { return m_View; }
 	const glm::mat4& GetInverseView() const { return m_InverseView; }
 
+	float GetVerticalFOV() const { return m_VerticalFOV; }
+	float GetNearClip() const { return m_NearClip; }
+	float GetFarClip() const { return m_FarClip; }
+
 	const glm::vec3& GetPosition() const { return m_Position; }
 	const glm::vec3& GetDirection() const { return m_ForwardDirection; }
 
@@ -0,0 +1,148 @@
+#include "Checkpoint.h"
+#include "Camera.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace Utility
+{
+	/*
+	*		FNV-1a Hash
+	*		* http://www.isthe.com/chongo/tech/comp/fnv/
+	*/
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	static uint64_t HashVector(const std::vector<T>& values, uint64_t hash)
+	{
+		size_t count = values.size();
+		hash = HashBytes(&count, sizeof(count), hash);
+		return HashBytes(values.data(), count * sizeof(T), hash);
+	}
+}
+
+bool Checkpoint::Open(const std::string& path, uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_ChunkRows = (std::max(height, 1u) + TargetChunkCount - 1) / TargetChunkCount;
+
+	// Rounding up the rows can leave fewer chunks than targeted, an empty chunk would never get a sample count
+	m_ChunkCount = (std::max(height, 1u) + m_ChunkRows - 1) / m_ChunkRows;
+	m_NextChunk = 0;
+
+	size_t size = GetLuminanceOffset() + (size_t)width * height * sizeof(float);
+	if (!m_File.Open(path, size))
+		return false;
+
+	// A file from another resolution or version is unusable
+	Header expected;
+	Header* header = GetHeader();
+	if (memcmp(header->Magic, expected.Magic, sizeof(expected.Magic)) != 0 || header->Version != expected.Version ||
+		header->Width != width || header->Height != height || header->ChunkRows != m_ChunkRows || header->ChunkCount != m_ChunkCount)
+	{
+		Reset(0, 0);
+	}
+
+	return true;
+}
+
+uint32_t Checkpoint::Restore(uint64_t sceneHash, uint64_t cameraHash, glm::vec4* accumulation, float* luminanceSquared) const
+{
+	const Header* header = GetHeader();
+	if (header->SceneHash != sceneHash || header->CameraHash != cameraHash)
+		return 0;
+
+	// Chunks may be a few frames apart, resume from the smallest common sample count
+	const uint32_t* sampleCounts = GetSampleCounts();
+	uint32_t sampleCount = *std::min_element(sampleCounts, sampleCounts + m_ChunkCount);
+	if (sampleCount == 0)
+		return 0;
+
+	const glm::vec4* color = (const glm::vec4*)(m_File.GetData() + GetColorOffset());
+	const float* luminance = (const float*)(m_File.GetData() + GetLuminanceOffset());
+	for (size_t i = 0; i < (size_t)m_Width * m_Height; i++)
+	{
+		accumulation[i] = color[i] * (float)sampleCount;
+		luminanceSquared[i] = luminance[i] * (float)sampleCount;
+	}
+
+	return sampleCount;
+}
+
+void Checkpoint::Reset(uint64_t sceneHash, uint64_t cameraHash)
+{
+	Header* header = GetHeader();
+	*header = Header();
+	header->Width = m_Width;
+	header->Height = m_Height;
+	header->ChunkRows = m_ChunkRows;
+	header->ChunkCount = m_ChunkCount;
+	header->SceneHash = sceneHash;
+	header->CameraHash = cameraHash;
+
+	memset(GetSampleCounts(), 0, m_ChunkCount * sizeof(uint32_t));
+	m_NextChunk = 0;
+
+	m_File.Flush(0, GetColorOffset());
+}
+
+void Checkpoint::WriteNextChunk(const glm::vec4* accumulation, const float* luminanceSquared, uint32_t sampleCount)
+{
+	uint32_t chunk = m_NextChunk;
+	m_NextChunk = (m_NextChunk + 1) % m_ChunkCount;
+
+	size_t begin = (size_t)chunk * m_ChunkRows * m_Width;
+	size_t end = std::min((size_t)(chunk + 1) * m_ChunkRows, (size_t)m_Height) * m_Width;
+	if (begin >= end)
+		return;
+
+	// Invalidate the chunk while it is being overwritten
+	uint32_t* sampleCounts = GetSampleCounts();
+	sampleCounts[chunk] = 0;
+
+	glm::vec4* color = (glm::vec4*)(m_File.GetData() + GetColorOffset());
+	float* luminance = (float*)(m_File.GetData() + GetLuminanceOffset());
+	float inverseSampleCount = 1.0f / (float)sampleCount;
+	for (size_t i = begin; i < end; i++)
+	{
+		color[i] = accumulation[i] * inverseSampleCount;
+		luminance[i] = luminanceSquared[i] * inverseSampleCount;
+	}
+
+	sampleCounts[chunk] = sampleCount;
+
+	m_File.Flush(GetColorOffset() + begin * sizeof(glm::vec4), (end - begin) * sizeof(glm::vec4));
+	m_File.Flush(GetLuminanceOffset() + begin * sizeof(float), (end - begin) * sizeof(float));
+	m_File.Flush(0, GetColorOffset());
+}
+
+uint64_t Checkpoint::HashScene(const Scene& scene, bool physicallyBased)
+{
+	uint64_t hash = Utility::HashBytes(&physicallyBased, sizeof(physicallyBased));
+	hash = Utility::HashVector(scene.Spheres, hash);
+	hash = Utility::HashVector(scene.Planes, hash);
+	hash = Utility::HashVector(scene.Boxes, hash);
+	hash = Utility::HashVector(scene.Discs, hash);
+	hash = Utility::HashVector(scene.Materials, hash);
+	return hash;
+}
+
+uint64_t Checkpoint::HashCamera(const Camera& camera, uint32_t width, uint32_t height)
+{
+	uint64_t hash = Utility::HashBytes(&camera.GetInverseView(), sizeof(glm::mat4));
+	hash = Utility::HashBytes(&camera.GetInverseProjection(), sizeof(glm::mat4), hash);
+	hash = Utility::HashBytes(&width, sizeof(width), hash);
+	return Utility::HashBytes(&height, sizeof(height), hash);
+}
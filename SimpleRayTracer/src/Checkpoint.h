@@ -0,0 +1,63 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+#include <string>
+
+/*
+*		Progressive accumulation checkpoint (.srck)
+*		* Header | per chunk sample counts | mean color (vec4) | mean squared luminance (float)
+*		* One horizontal band of rows (chunk) is refreshed per frame, so the mapped file is
+*		* flushed incrementally while rendering continues
+*		* Means are stored instead of sums so chunks written on different frames stay consistent
+*		* The sampler is seeded from pixel index and frame count, the sample count is its whole state
+*/
+
+class Checkpoint
+{
+public:
+	struct Header
+	{
+		char Magic[4] = { 'S', 'R', 'C', 'K' };
+		uint32_t Version = 1;
+		uint32_t Width = 0, Height = 0;
+		uint32_t ChunkRows = 0, ChunkCount = 0;
+		uint64_t SceneHash = 0;
+		uint64_t CameraHash = 0;
+	};
+
+public:
+	bool Open(const std::string& path, uint32_t width, uint32_t height);
+	void Close() { m_File.Close(); }
+	bool IsOpen() const { return m_File.IsOpen(); }
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+
+	// Returns the number of samples restored, 0 if the checkpoint belongs to another scene or camera
+	uint32_t Restore(uint64_t sceneHash, uint64_t cameraHash, glm::vec4* accumulation, float* luminanceSquared) const;
+
+	// Discards the stored samples and binds the checkpoint to a new scene and camera
+	void Reset(uint64_t sceneHash, uint64_t cameraHash);
+
+	// Copies the next chunk of rows, sampleCount is the number of samples in the buffers
+	void WriteNextChunk(const glm::vec4* accumulation, const float* luminanceSquared, uint32_t sampleCount);
+
+	static uint64_t HashScene(const class Scene& scene, bool physicallyBased);
+	static uint64_t HashCamera(const class Camera& camera, uint32_t width, uint32_t height);
+
+private:
+	Header* GetHeader() const { return (Header*)m_File.GetData(); }
+	uint32_t* GetSampleCounts() const { return (uint32_t*)(m_File.GetData() + sizeof(Header)); }
+	size_t GetColorOffset() const { return sizeof(Header) + m_ChunkCount * sizeof(uint32_t); }
+	size_t GetLuminanceOffset() const { return GetColorOffset() + (size_t)m_Width * m_Height * sizeof(glm::vec4); }
+
+private:
+	MappedFile m_File;
+	uint32_t m_Width = 0, m_Height = 0;
+	uint32_t m_ChunkRows = 0, m_ChunkCount = 0;
+	uint32_t m_NextChunk = 0;
+
+	// A full refresh every ChunkCount frames keeps the per-frame copy far below 1% of the frame
+	static constexpr uint32_t TargetChunkCount = 64;
+};
@@ -0,0 +1,135 @@
+#include "MappedFile.h"
+
+#ifdef WL_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef WL_PLATFORM_WINDOWS
+
+bool MappedFile::Open(const std::string& path, size_t size)
+{
+	Close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	// Truncate or extend to the exact size, the mapping would only ever grow the file
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_File = file;
+	m_Mapping = mapping;
+	m_Data = (uint8_t*)data;
+	m_Size = size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+	{
+		FlushViewOfFile(m_Data, m_Size);
+		UnmapViewOfFile(m_Data);
+		CloseHandle(m_Mapping);
+		CloseHandle(m_File);
+	}
+
+	m_Data = nullptr;
+	m_Mapping = nullptr;
+	m_File = nullptr;
+	m_Size = 0;
+}
+
+void MappedFile::Flush(size_t offset, size_t size)
+{
+	// Returns once the dirty pages are queued, the lazy writer does the I/O
+	FlushViewOfFile(m_Data + offset, size);
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, size_t size)
+{
+	Close();
+
+	int descriptor = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (descriptor < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 || ((size_t)info.st_size != size && ftruncate(descriptor, (off_t)size) != 0))
+	{
+		close(descriptor);
+		return false;
+	}
+
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	m_Descriptor = descriptor;
+	m_Data = (uint8_t*)data;
+	m_Size = size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+	{
+		// Shared mappings are written back by the kernel after munmap, no need to block here
+		msync(m_Data, m_Size, MS_ASYNC);
+		munmap(m_Data, m_Size);
+		close(m_Descriptor);
+	}
+
+	m_Data = nullptr;
+	m_Descriptor = -1;
+	m_Size = 0;
+}
+
+void MappedFile::Flush(size_t offset, size_t size)
+{
+	// msync needs a page aligned address
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t alignedOffset = offset - offset % pageSize;
+	msync(m_Data + alignedOffset, size + (offset - alignedOffset), MS_ASYNC);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Read-write memory mapping of a fixed size file
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Creates the file if needed and resizes it, existing contents are kept when the size matches
+	bool Open(const std::string& path, size_t size);
+	void Close();
+
+	// Schedules a write-back of the range without waiting for the disk
+	void Flush(size_t offset, size_t size);
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	uint8_t* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+
+#ifdef WL_PLATFORM_WINDOWS
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#else
+	int m_Descriptor = -1;
+#endif
+};
@@ -0,0 +1,156 @@
+#include "RadianceCache.h"
+
+#include <cmath>
+
+namespace Utility
+{
+	static void AtomicAdd(std::atomic<float>& target, float value)
+	{
+		float current = target.load(std::memory_order_relaxed);
+		while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	static uint64_t Combine(uint64_t hash, int32_t value)
+	{
+		// FNV-1a step per value, finalized in HashKey
+		hash ^= (uint32_t)value;
+		return hash * 1099511628211ull;
+	}
+}
+
+void RadianceCache::Allocate()
+{
+	if (m_Cells)
+		return;
+
+	m_Cells = std::make_unique<Cell[]>(CellCount);
+	for (uint32_t i = 0; i < CellCount; i++)
+	{
+		for (std::atomic<float>& channel : m_Cells[i].Radiance)
+		{
+			channel.store(0.0f, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool RadianceCache::Lookup(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& cameraPosition, glm::vec3& radiance) const
+{
+	uint64_t hash = HashKey(position, normal, cameraPosition);
+	uint64_t tag = MakeTag(hash);
+
+	for (uint32_t probe = 0; probe < MaxProbes; probe++)
+	{
+		const Cell& cell = m_Cells[(hash + probe) & (CellCount - 1)];
+		uint64_t current = cell.Tag.load(std::memory_order_acquire);
+		if (current != tag)
+		{
+			// Keys are inserted at the first free probe, so a free cell ends the search,
+			// and a cell that is being reset (BusyTag) is a miss as well
+			if ((current >> 32) != (tag >> 32))
+				return false;
+
+			continue;
+		}
+
+		uint32_t sampleCount = cell.SampleCount.load(std::memory_order_relaxed);
+		if (sampleCount < MinSampleCount)
+			return false;
+
+		glm::vec3 sum(
+			cell.Radiance[0].load(std::memory_order_relaxed),
+			cell.Radiance[1].load(std::memory_order_relaxed),
+			cell.Radiance[2].load(std::memory_order_relaxed));
+
+		// Reclaimed for another key, or samples added while reading, the sums and count may not match
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (cell.Tag.load(std::memory_order_relaxed) != tag || cell.SampleCount.load(std::memory_order_relaxed) != sampleCount)
+			return false;
+
+		radiance = sum / (float)sampleCount;
+		return true;
+	}
+
+	return false;
+}
+
+void RadianceCache::Insert(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& cameraPosition, const glm::vec3& radiance)
+{
+	uint64_t hash = HashKey(position, normal, cameraPosition);
+	uint64_t tag = MakeTag(hash);
+
+	for (uint32_t probe = 0; probe < MaxProbes; probe++)
+	{
+		Cell& cell = m_Cells[(hash + probe) & (CellCount - 1)];
+		uint64_t current = cell.Tag.load(std::memory_order_acquire);
+
+		if (current != tag && current != BusyTag && (current >> 32) != (tag >> 32))
+		{
+			// Empty or left over from an older generation, claim it. Readers see BusyTag (a miss)
+			// until the reset is done, never the new tag next to the old generation's sums
+			if (cell.Tag.compare_exchange_strong(current, BusyTag, std::memory_order_acquire))
+			{
+				for (uint32_t channel = 0; channel < 3; channel++)
+				{
+					cell.Radiance[channel].store(radiance[channel], std::memory_order_relaxed);
+				}
+				cell.SampleCount.store(1, std::memory_order_relaxed);
+				cell.Tag.store(tag, std::memory_order_release);
+				return;
+			}
+		}
+
+		// Another thread is resetting this cell (a failed claim leaves its tag in current),
+		// dropping one sample is harmless for a cache
+		if (current == BusyTag)
+			return;
+
+		if (current != tag)
+			continue;
+
+		// Converged cells stop taking samples, which also keeps hot cells from being contended
+		if (cell.SampleCount.load(std::memory_order_relaxed) >= MaxSampleCount)
+			return;
+
+		for (uint32_t channel = 0; channel < 3; channel++)
+		{
+			Utility::AtomicAdd(cell.Radiance[channel], radiance[channel]);
+		}
+		cell.SampleCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+}
+
+uint64_t RadianceCache::HashKey(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& cameraPosition) const
+{
+	// Cell size doubles per level, levels follow the distance to the camera
+	float footprint = glm::max(glm::distance(position, cameraPosition) * CellSizePerDistance, MinCellSize);
+	int level = glm::min((int)std::ceil(std::log2(footprint / MinCellSize)), MaxLevel);
+	float cellSize = MinCellSize * (float)(1 << level);
+
+	glm::vec3 cell = glm::floor(position / cellSize);
+
+	// Dominant axis of the normal, so both sides of a thin object use different cells
+	glm::vec3 absoluteNormal = glm::abs(normal);
+	int axis = absoluteNormal.x > absoluteNormal.y ? (absoluteNormal.x > absoluteNormal.z ? 0 : 2) : (absoluteNormal.y > absoluteNormal.z ? 1 : 2);
+	int direction = axis * 2 + (normal[axis] < 0.0f ? 1 : 0);
+
+	uint64_t hash = 14695981039346656037ull;
+	hash = Utility::Combine(hash, (int32_t)cell.x);
+	hash = Utility::Combine(hash, (int32_t)cell.y);
+	hash = Utility::Combine(hash, (int32_t)cell.z);
+	hash = Utility::Combine(hash, direction | (level << 3));
+
+	// Spread the bits, the low ones pick the cell and the high ones form the tag
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+uint64_t RadianceCache::MakeTag(uint64_t hash) const
+{
+	uint64_t generation = m_Generation.load(std::memory_order_relaxed);
+	return (generation << 32) | (uint32_t)(hash >> 32) | 1u;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <memory>
+
+/*
+*		World space radiance cache for diffuse surfaces
+*		* Open addressed hash grid, cells are keyed by quantized position, dominant normal axis and level
+*		* The level grows with distance to the camera, so far away cells cover more space
+*		* Cells are claimed and updated with atomics only, every render thread inserts concurrently
+*		* Invalidate bumps a generation counter, cells from older generations read as empty
+*		* A claimed cell holds BusyTag until it is reset, then its tag is published with release
+*/
+
+class RadianceCache
+{
+public:
+	RadianceCache() = default;
+
+	// Allocates the table on first use, it is only needed while the cache is enabled
+	void Allocate();
+	bool IsAllocated() const { return m_Cells != nullptr; }
+
+	void Invalidate() { m_Generation.fetch_add(1, std::memory_order_relaxed); }
+
+	// Returns true if the cell has seen enough samples to stand in for a traced path
+	bool Lookup(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& cameraPosition, glm::vec3& radiance) const;
+	void Insert(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& cameraPosition, const glm::vec3& radiance);
+
+private:
+	struct Cell
+	{
+		std::atomic<uint64_t> Tag{ 0 }; // Generation (high 32 bits) and odd key hash (low 32 bits), 0 = empty
+		std::atomic<float> Radiance[3];
+		std::atomic<uint32_t> SampleCount{ 0 };
+	};
+
+	uint64_t HashKey(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& cameraPosition) const;
+	uint64_t MakeTag(uint64_t hash) const;
+
+private:
+	static constexpr uint64_t BusyTag = 2; // Never a real tag (those are odd) and never of the current generation
+	static constexpr uint32_t CellCount = 1 << 19; // Power of two
+	static constexpr uint32_t MaxProbes = 4;
+	static constexpr uint32_t MinSampleCount = 16;
+	static constexpr uint32_t MaxSampleCount = 1024;
+
+	static constexpr float MinCellSize = 0.05f;
+	static constexpr float CellSizePerDistance = 0.015f; // Roughly constant screen space size
+	static constexpr int MaxLevel = 15;
+
+	std::unique_ptr<Cell[]> m_Cells;
+	std::atomic<uint32_t> m_Generation{ 1 };
+};
@@ -7,75 +7,36 @@
 #include "Renderer.h"
 #include "Camera.h"
 #include "Scene.h"
+#include "SceneLoader.h"
+#include "SequenceRenderer.h"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <thread>
+
 using namespace Walnut;
 
 class ExampleLayer : public Walnut::Layer
 {
 public:
 	ExampleLayer()
-		: m_Camera(45.0f, 0.1f, 100.0f) 
+		: m_Camera(45.0f, 0.1f, 100.0f), m_Scene(SceneLoader::CreateDefaultScene())
+	{
+	}
+
+	~ExampleLayer()
 	{
-		Material& ground = m_Scene.Materials.emplace_back();
-		ground.Albedo = { 0.2f, 0.2f, 0.2f };
-		ground.Roughness = 0.5f;
-		ground.Metallic = 0.0f;
-
-		Material& floatingSphere = m_Scene.Materials.emplace_back();
-		floatingSphere.Albedo = { 0.2f, 0.55f, 0.6f };
-		floatingSphere.Roughness = 0.2f;
-		floatingSphere.Metallic = 1.0f;
-
-		Material& EmissiveSphere = m_Scene.Materials.emplace_back();
-		EmissiveSphere.Albedo = { 0.9f, 0.6f, 0.4f };
-		EmissiveSphere.Roughness = 0.1f;
-		EmissiveSphere.EmissionColor = { 0.9f, 0.6f, 0.4f };
-		EmissiveSphere.EmissionStrength = 6.0f;
-
-		Material& SideSphere = m_Scene.Materials.emplace_back();
-		SideSphere.Albedo = { 0.8f, 0.3f, 0.2f };
-		SideSphere.Roughness = 0.28f;
-		SideSphere.Metallic = 1.0f;
-
-		Material& BackSphere = m_Scene.Materials.emplace_back();
-		BackSphere.Albedo = { 0.2f, 0.8f, 0.1f };
-		BackSphere.Roughness = 1.0f;
-
-		Sphere FloorSphere;
-		FloorSphere.Position = { 0.0f, -100.5f, 0.0f };
-		FloorSphere.Radius = 100.0f;
-		FloorSphere.MaterialIndex = 0;
-		m_Scene.Spheres.push_back(FloorSphere); 
-
-		Sphere sphere;
-		sphere.Position = { 0.0f, 0.0f, 0.0f };
-		sphere.Radius = 0.5f;
-		sphere.MaterialIndex = 1;
-		m_Scene.Spheres.push_back(sphere);
-
-		Sphere sphere2;
-		sphere2.Position = { 2.0f, 2.5f, 0.0f };
-		sphere2.Radius = 1.0f;
-		sphere2.MaterialIndex = 2;
-		m_Scene.Spheres.push_back(sphere2);
-
-		Sphere sphere3;
-		sphere3.Position = { -2.0f, 0.49f, 1.0f };
-		sphere3.Radius = 1.0f;
-		sphere3.MaterialIndex = 3;
-		m_Scene.Spheres.push_back(sphere3);
-
-		Sphere sphere4;
-		sphere4.Position = {-1.5f, 0.31f, -6.0f };
-		sphere4.Radius = 1.0f;
-		sphere4.MaterialIndex = 4;
-		m_Scene.Spheres.push_back(sphere4);
-
-		Light light;
-		light.Position = { -1.0f, -1.0f, -1.0f };
-		m_Scene.Lights.push_back(light);
+		m_TiledStatus.Cancel = true;
+		if (m_TiledRenderThread.joinable())
+		{
+			m_TiledRenderThread.join();
+		}
+
+		m_SequenceStatus.Cancel = true;
+		if (m_SequenceThread.joinable())
+		{
+			m_SequenceThread.join();
+		}
 	}
 
 	virtual void OnUpdate(float deltaTime) override
@@ -98,6 +59,33 @@ public:
 		/* Accumulation */
 		ImGui::Checkbox("Accumulate", &m_Renderer.GetSettings().Accumulate);
 		ImGui::Checkbox("Fast Random", &m_Renderer.GetSettings().FastRandom);
+		if (ImGui::Checkbox("Physically Based", &m_Renderer.GetSettings().PhysicallyBased)) { m_Renderer.ResetFrameCount(); }
+		if (ImGui::Checkbox("Cache Primary Hits", &m_Renderer.GetSettings().CachePrimaryHits)) { m_Renderer.ResetFrameCount(); }
+		if (ImGui::Checkbox("Checkpoint", &m_Renderer.GetSettings().Checkpoint)) { m_Renderer.ResetFrameCount(); }
+
+		/* Frame Budget */
+		ImGui::Checkbox("Time Budget", &m_Renderer.GetSettings().TimeBudget);
+		if (m_Renderer.GetSettings().TimeBudget)
+		{
+			ImGui::DragFloat("Frame Budget (ms)", &m_Renderer.GetSettings().FrameBudget, 0.5f, 1.0f, 100.0f);
+		}
+		ImGui::Text("Samples: %u (%.2f per frame)", m_Renderer.GetSampleCount(), m_Renderer.GetSamplesPerFrame());
+
+		/* Radiance Cache */
+		if (ImGui::Checkbox("Cache Radiance", &m_Renderer.GetSettings().CacheRadiance)) { m_Renderer.ResetFrameCount(); }
+		const Renderer::TraceStatistics& traceStatistics = m_Renderer.GetTraceStatistics();
+		ImGui::Text("Rays traced: %.2fM", (double)traceStatistics.RaysTraced / 1e6);
+		if (m_Renderer.GetSettings().CacheRadiance && traceStatistics.CacheLookups > 0)
+		{
+			ImGui::Text("Cache hits: %.1f%%", 100.0 * (double)traceStatistics.CacheHits / (double)traceStatistics.CacheLookups);
+		}
+
+		/* Convergence */
+		ImGui::Checkbox("Measure Variance", &m_Renderer.GetSettings().MeasureVariance);
+		if (m_Renderer.GetSettings().MeasureVariance)
+		{
+			ImGui::Text("Sample variance: %.5f", m_Renderer.GetSampleVariance());
+		}
 
 		if (ImGui::Button("Reset"))
 		{
@@ -112,7 +100,7 @@ public:
 		/* Object Controls */
 		ImGui::Text("Objects");
 		ImGui::Separator();
-		for (size_t i = 1; i < m_Scene.Spheres.size(); i++)
+		for (size_t i = 0; i < m_Scene.Spheres.size(); i++)
 		{
 			ImGui::PushID(i);
 			/* Sphere Position and Radius */
@@ -144,6 +132,49 @@ public:
 			ImGui::PopID();
 		}
 
+		/* Offline Rendering */
+		ImGui::Text("Offline Render");
+		ImGui::Separator();
+		ImGui::InputText("Output", m_TiledOutputPath, sizeof(m_TiledOutputPath));
+		ImGui::InputInt2("Resolution", m_TiledResolution);
+		ImGui::InputInt("Tile Size", &m_TiledTileSize);
+		ImGui::InputInt("Samples", &m_TiledSamples);
+
+		if (m_TiledStatus.Running)
+		{
+			ImGui::Text("Tiles: %u / %u", m_TiledStatus.TilesDone.load(), m_TiledStatus.TileCount.load());
+			if (ImGui::Button("Cancel"))
+			{
+				m_TiledStatus.Cancel = true;
+			}
+		}
+		else if (ImGui::Button("Render To File"))
+		{
+			RenderTiled();
+		}
+		ImGui::Separator();
+
+		/* Sequence Rendering */
+		ImGui::Text("Turntable Sequence");
+		ImGui::Separator();
+		ImGui::InputInt2("Frame Size", m_SequenceResolution);
+		ImGui::InputInt("Frames", &m_SequenceFrameCount);
+		ImGui::InputInt("Frame Samples", &m_SequenceSamples);
+
+		if (m_SequenceStatus.Running)
+		{
+			ImGui::Text("Frames: %u / %u", m_SequenceStatus.FramesDone.load(), m_SequenceStatus.FrameCount.load());
+			if (ImGui::Button("Cancel Sequence"))
+			{
+				m_SequenceStatus.Cancel = true;
+			}
+		}
+		else if (ImGui::Button("Render Sequence"))
+		{
+			RenderSequence();
+		}
+		ImGui::Separator();
+
 		/* Light Source Movement */
 		/*
 		ImGui::Separator();
@@ -188,6 +219,77 @@ public:
 		m_LastRenderTime = timer.ElapsedMillis();
 	}
 
+	void RenderTiled()
+	{
+		if (m_TiledRenderThread.joinable())
+		{
+			m_TiledRenderThread.join();
+		}
+
+		Renderer::TiledRenderSpecification specification;
+		specification.OutputPath = m_TiledOutputPath;
+		specification.Width = (uint32_t)std::max(m_TiledResolution[0], 1);
+		specification.Height = (uint32_t)std::max(m_TiledResolution[1], 1);
+		specification.TileSize = (uint32_t)std::max(m_TiledTileSize, 8);
+		specification.SamplesPerPixel = (uint32_t)std::max(m_TiledSamples, 1);
+		m_OfflineRenderer.GetSettings() = m_Renderer.GetSettings();
+
+		m_TiledStatus.Running = true;
+		m_TiledStatus.Cancel = false;
+
+		// Snapshot the scene and camera so the UI can keep editing them
+		m_TiledRenderThread = std::thread([this, specification, scene = m_Scene, camera = m_Camera]()
+			{
+				m_OfflineRenderer.RenderTiled(camera, scene, specification, &m_TiledStatus);
+				m_TiledStatus.Running = false;
+			});
+	}
+
+	void RenderSequence()
+	{
+		if (m_SequenceThread.joinable())
+		{
+			m_SequenceThread.join();
+		}
+
+		SequenceRenderer::Specification specification;
+		specification.Width = (uint32_t)std::max(m_SequenceResolution[0], 1);
+		specification.Height = (uint32_t)std::max(m_SequenceResolution[1], 1);
+		specification.FrameCount = (uint32_t)std::max(m_SequenceFrameCount, 1);
+		specification.SamplesPerPixel = (uint32_t)std::max(m_SequenceSamples, 1);
+
+		// Orbit the scene origin at the current camera distance and height
+		const glm::vec3 cameraPosition = m_Camera.GetPosition();
+		float radius = glm::length(glm::vec2(cameraPosition.x, cameraPosition.z));
+
+		// On the y axis the orbit collapses and the view direction is parallel to up, orbit at 45 degrees instead
+		if (radius < 0.01f)
+		{
+			radius = glm::max(std::abs(cameraPosition.y), 1.0f);
+		}
+		const float duration = (float)specification.FrameCount / specification.FrameRate;
+		constexpr uint32_t keyframeCount = 32;
+		for (uint32_t i = 0; i <= keyframeCount; i++)
+		{
+			float angle = 2.0f * 3.14159265f * (float)i / (float)keyframeCount;
+
+			CameraKeyframe& keyframe = specification.CameraKeyframes.emplace_back();
+			keyframe.Time = duration * (float)i / (float)keyframeCount;
+			keyframe.Position = { radius * std::sin(angle), cameraPosition.y, radius * std::cos(angle) };
+			keyframe.Direction = glm::vec3(0.0f) - keyframe.Position;
+		}
+
+		m_SequenceRenderer.GetSettings() = m_Renderer.GetSettings();
+		m_SequenceStatus.Running = true;
+		m_SequenceStatus.Cancel = false;
+
+		m_SequenceThread = std::thread([this, specification, scene = m_Scene, camera = m_Camera]()
+			{
+				m_SequenceRenderer.Render(scene, camera, specification, &m_SequenceStatus);
+				m_SequenceStatus.Running = false;
+			});
+	}
+
 	void UpdateSphereColor() 
 	{
 		m_Renderer.ChangeSphereColor(m_colorR, m_colorG, m_colorB);
@@ -208,6 +310,23 @@ private:
 
 	float m_LastRenderTime = 0.0f;
 
+	// Offline tiled rendering
+	Renderer m_OfflineRenderer;
+	Renderer::TiledRenderStatus m_TiledStatus;
+	std::thread m_TiledRenderThread;
+	char m_TiledOutputPath[256] = "Render.srtc";
+	int m_TiledResolution[2] = { 8192, 8192 };
+	int m_TiledTileSize = 256;
+	int m_TiledSamples = 256;
+
+	// Camera path sequences
+	SequenceRenderer m_SequenceRenderer;
+	SequenceRenderer::Status m_SequenceStatus;
+	std::thread m_SequenceThread;
+	int m_SequenceResolution[2] = { 1280, 720 };
+	int m_SequenceFrameCount = 120;
+	int m_SequenceSamples = 64;
+
 	// Color sliders
 	float m_colorR = 1.0f;
 	float m_colorG = 1.0f;
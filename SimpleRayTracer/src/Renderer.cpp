@@ -2,11 +2,17 @@
 #include "Camera.h"
 #include "Ray.h"
 #include "Scene.h"
+#include "BSDF.h"
+#include "TileWriter.h"
+#include "RadianceCache.h"
 
 #include "Walnut/Random.h"
 
 #include <execution>
 #include <chrono>
+#include <numeric>
+#include <thread>
+#include <filesystem>
 
 namespace Utility
 {
@@ -30,6 +36,11 @@ namespace Utility
 		return glm::vec4(red, green, blue, alpha);
 	}
 
+	static float Luminance(const glm::vec3& color)
+	{
+		return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	}
+
 	/*
 	*					PCG Hash Function
 	*		* https://jcgt.org/published/0009/03/02/
@@ -90,6 +101,11 @@ void Renderer::OnResize(uint32_t width, uint32_t height)
 	delete[] m_AccumulationBuffer;
 	m_AccumulationBuffer = new glm::vec4[width * height];
 
+	delete[] m_LuminanceSquaredBuffer;
+	m_LuminanceSquaredBuffer = new float[width * height];
+
+	m_PrimaryHitCache.resize(width * height);
+
 	m_HorizontalPixelIterator.resize(width);
 	for (uint32_t i = 0; i < width; i++)
 	{
@@ -110,11 +126,121 @@ void Renderer::Render(const Camera& camera, const Scene& scene)
 	m_CurrentScene = &scene;
 	m_CurrentCamera = &camera;
 
+	if (m_RowCursor == 0 && m_Settings.Checkpoint && m_Settings.Accumulate)
+	{
+		UpdateCheckpoint(camera, scene);
+	}
+	else if (!m_Settings.Checkpoint)
+	{
+		m_Checkpoint.Close();
+		m_FailedCheckpointPath.clear();
+	}
+
+	PrepareRadianceCache(scene);
+	m_RaysTraced = 0;
+	m_CacheLookups = 0;
+	m_CacheHits = 0;
+
+	const uint32_t height = m_FinalImage->GetHeight();
+	uint64_t pixelsTraced = 0;
+
+	if (m_Settings.TimeBudget)
+	{
+		RenderWithinBudget(pixelsTraced);
+	}
+	else
+	{
+		// Finish a pass left over from budgeted frames, otherwise render a whole one
+		uint32_t rowCount = height - m_RowCursor;
+		RenderRows(m_RowCursor, rowCount);
+		ResolveRows(m_RowCursor, rowCount);
+		CompletePass();
+
+		pixelsTraced = (uint64_t)rowCount * m_FinalImage->GetWidth();
+	}
+
+	m_SamplesPerFrame = (float)((double)pixelsTraced / ((double)m_FinalImage->GetWidth() * height));
+
+	// Traced rows were resolved as they finished, the rest of the image is still current
+	auto uploadStart = std::chrono::steady_clock::now();
+	m_FinalImage->SetData(m_ImageData);
+
+	float uploadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+	m_UploadTime = m_UploadTime > 0.0f ? glm::mix(m_UploadTime, uploadTime, 0.25f) : uploadTime;
+
+	m_TraceStatistics.RaysTraced = m_RaysTraced;
+	m_TraceStatistics.CacheLookups = m_CacheLookups;
+	m_TraceStatistics.CacheHits = m_CacheHits;
+}
+
+void Renderer::RenderWithinBudget(uint64_t& pixelsTraced)
+{
+	const uint32_t width = m_FinalImage->GetWidth();
+	const uint32_t height = m_FinalImage->GetHeight();
+
+	// Uploading happens after tracing, so leave room for it
+	const float budget = glm::max(m_Settings.FrameBudget - m_UploadTime, 1.0f);
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t band = 0;; band++)
+	{
+		float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		uint32_t rowsLeft = height - m_RowCursor;
+		uint32_t rowCount;
+
+		if (m_SampleCost > 0.0f)
+		{
+			float affordableRows = (budget - elapsed) / (m_SampleCost * (float)width);
+
+			// Tiny bands don't fill the thread pool, stop instead (the first band always runs so every frame makes progress)
+			if (band > 0 && affordableRows < (float)glm::min(MinimumBandRows, rowsLeft))
+				break;
+
+			rowCount = (uint32_t)glm::clamp(affordableRows, 1.0f, (float)rowsLeft);
+		}
+		else
+		{
+			// No measurement yet, probe with a small band
+			rowCount = glm::min(glm::max(height / 16, 1u), rowsLeft);
+		}
+
+		// Bands are resolved before the pass can complete and advance the sample count, the cost covers both
+		auto bandStart = std::chrono::steady_clock::now();
+		RenderRows(m_RowCursor, rowCount);
+		ResolveRows(m_RowCursor, rowCount);
+		float bandTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - bandStart).count();
+
+		float sampleCost = bandTime / (float)(rowCount * width);
+		m_SampleCost = m_SampleCost > 0.0f ? glm::mix(m_SampleCost, sampleCost, 0.25f) : sampleCost;
+
+		m_RowCursor += rowCount;
+		pixelsTraced += (uint64_t)rowCount * width;
+
+		if (m_RowCursor == height)
+		{
+			CompletePass();
+
+			// Without accumulation another pass would just overwrite this one
+			if (!m_Settings.Accumulate)
+				break;
+		}
+	}
+}
+
+void Renderer::RenderRows(uint32_t firstRow, uint32_t rowCount)
+{
+	const uint32_t width = m_FinalImage->GetWidth();
+
+	// The first pass overwrites, so only the rows it reaches are cleared
 	if (m_FrameCount == 1)
 	{
-		memset(m_AccumulationBuffer, 0, m_FinalImage->GetWidth() * m_FinalImage->GetHeight() * sizeof(glm::vec4));
+		memset(m_AccumulationBuffer + firstRow * width, 0, rowCount * width * sizeof(glm::vec4));
+		memset(m_LuminanceSquaredBuffer + firstRow * width, 0, rowCount * width * sizeof(float));
 	}
 
+	auto rowsBegin = m_VerticalPixelIterator.begin() + firstRow;
+	auto rowsEnd = rowsBegin + rowCount;
+
 	/*
 		* More efficient by rendering horizontally instead of vertically
 		* by accessing contiguous memory
@@ -125,43 +251,62 @@ void Renderer::Render(const Camera& camera, const Scene& scene)
 #if MT_RENDER
 
 	// Parallelize the rendering process
-	std::for_each(std::execution::par, m_VerticalPixelIterator.begin(), m_VerticalPixelIterator.end(), [this](uint32_t y)
+	std::for_each(std::execution::par, rowsBegin, rowsEnd, [this, width](uint32_t y)
 		{
-			std::for_each(std::execution::par, m_HorizontalPixelIterator.begin(), m_HorizontalPixelIterator.end(), [this, y](uint32_t x)
+			// Statistics are summed per row and published once, not contended per sample
+			TraceStatistics rowStatistics = std::transform_reduce(std::execution::par, m_HorizontalPixelIterator.begin(), m_HorizontalPixelIterator.end(), TraceStatistics(),
+				[](TraceStatistics a, const TraceStatistics& b) { return a += b; },
+				[this, width, y](uint32_t x)
 				{
 					// Calculate the color of the pixel at the coordinate and Update
-					glm::vec4 color = RayGen(x, y);
-					m_AccumulationBuffer[x + y * m_FinalImage->GetWidth()] += color;
-
-					glm::vec4 finalColor = m_AccumulationBuffer[x + y * m_FinalImage->GetWidth()];
-					finalColor /= (float)m_FrameCount;
+					TraceStatistics statistics;
+					glm::vec4 color = RayGen(x, y, statistics);
+					m_AccumulationBuffer[x + y * width] += color;
 
-					finalColor = glm::clamp(finalColor, glm::vec4(0.0f), glm::vec4(1.0f)); // Clamp the color to the range [0, 1]
-					m_ImageData[x + y * m_FinalImage->GetWidth()] = Utility::ConvertToRGBA(finalColor);
+					float luminance = Utility::Luminance(glm::vec3(color));
+					m_LuminanceSquaredBuffer[x + y * width] += luminance * luminance;
+					return statistics;
 				});
+			AddTraceStatistics(rowStatistics);
 		});
 
 #else
 
-	for (uint32_t y = 0; y < m_FinalImage->GetHeight(); y++)
+	TraceStatistics statistics;
+	for (auto it = rowsBegin; it != rowsEnd; it++)
 	{
-		for (uint32_t x = 0; x < m_FinalImage->GetWidth(); x++)
+		uint32_t y = *it;
+		for (uint32_t x = 0; x < width; x++)
 		{ 
 			// Calculate the color of the pixel at the coordinate and Update
-			glm::vec4 color = RayGen(x, y);
-			m_AccumulationBuffer[x + y * m_FinalImage->GetWidth()] += color;
+			glm::vec4 color = RayGen(x, y, statistics);
+			m_AccumulationBuffer[x + y * width] += color;
 
-			glm::vec4 finalColor = m_AccumulationBuffer[x + y * m_FinalImage->GetWidth()];
-			finalColor /= (float)m_FrameCount;
-
-			finalColor = glm::clamp(finalColor, glm::vec4(0.0f), glm::vec4(1.0f)); // Clamp the color to the range [0, 1]
-			m_ImageData[x + y * m_FinalImage->GetWidth()] = Utility::ConvertToRGBA(finalColor);
+			float luminance = Utility::Luminance(glm::vec3(color));
+			m_LuminanceSquaredBuffer[x + y * width] += luminance * luminance;
 		}
 	}
+	AddTraceStatistics(statistics);
 
 #endif
+}
 
-	m_FinalImage->SetData(m_ImageData);
+void Renderer::CompletePass()
+{
+	if (m_Settings.Checkpoint && m_Settings.Accumulate && m_Checkpoint.IsOpen())
+	{
+		m_Checkpoint.WriteNextChunk(m_AccumulationBuffer, m_LuminanceSquaredBuffer, m_FrameCount);
+	}
+
+	// Every row holds the same number of samples only here, between passes
+	if (m_Settings.MeasureVariance)
+	{
+		m_SampleVariance = CalculateSampleVariance(m_FrameCount);
+	}
+
+	// Primary hits traced this pass stay valid until the next ResetFrameCount
+	m_PrimaryHitCacheValid = m_Settings.CachePrimaryHits;
+	m_RowCursor = 0;
 
 	if (m_Settings.Accumulate)
 	{
@@ -175,6 +320,331 @@ void Renderer::Render(const Camera& camera, const Scene& scene)
 	}
 }
 
+void Renderer::ResolveRows(uint32_t firstRow, uint32_t rowCount)
+{
+	const uint32_t width = m_FinalImage->GetWidth();
+
+	// Called right after the rows are traced, before CompletePass advances the frame count
+	const float sampleCount = (float)m_FrameCount;
+
+	auto rowsBegin = m_VerticalPixelIterator.begin() + firstRow;
+	std::for_each(std::execution::par, rowsBegin, rowsBegin + rowCount, [this, width, sampleCount](uint32_t y)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				glm::vec4 finalColor = m_AccumulationBuffer[x + y * width];
+				finalColor /= sampleCount;
+
+				finalColor = glm::clamp(finalColor, glm::vec4(0.0f), glm::vec4(1.0f)); // Clamp the color to the range [0, 1]
+				m_ImageData[x + y * width] = Utility::ConvertToRGBA(finalColor);
+			}
+		});
+}
+
+void Renderer::UpdateCheckpoint(const Camera& camera, const Scene& scene)
+{
+	const uint32_t width = m_FinalImage->GetWidth();
+	const uint32_t height = m_FinalImage->GetHeight();
+
+	if (m_Checkpoint.IsOpen() && m_Checkpoint.GetWidth() == width && m_Checkpoint.GetHeight() == height)
+	{
+		if (m_FrameCount == 1)
+		{
+			ResumeFromCheckpoint(camera, scene);
+		}
+		return;
+	}
+
+	// The old resolution's file must not receive chunks of this one
+	m_Checkpoint.Close();
+
+	// Every checkpoint is a full size file, so while a window edge is dragged none is created
+	// until the size has held for a few samples (a file left at this size is reused right away)
+	std::string path = "Checkpoint_" + std::to_string(width) + "x" + std::to_string(height) + ".srck";
+
+	// A file that could not be opened (e.g. read only working directory) is not retried every
+	// frame, only after the size changes or checkpoints are toggled
+	if (path == m_FailedCheckpointPath)
+		return;
+	m_FailedCheckpointPath.clear();
+
+	std::error_code error;
+	if (m_FrameCount <= CheckpointSettleSamples && !std::filesystem::exists(path, error))
+		return;
+
+	if (!m_Checkpoint.Open(path, width, height))
+	{
+		m_FailedCheckpointPath = path;
+		return;
+	}
+
+	// Only the previous resolution is kept around, older ones are deleted
+	if (path != m_CheckpointPath)
+	{
+		if (!m_PreviousCheckpointPath.empty() && m_PreviousCheckpointPath != path)
+		{
+			std::filesystem::remove(m_PreviousCheckpointPath, error);
+		}
+		m_PreviousCheckpointPath = m_CheckpointPath;
+		m_CheckpointPath = path;
+	}
+
+	if (m_FrameCount == 1)
+	{
+		ResumeFromCheckpoint(camera, scene);
+	}
+	else
+	{
+		// Created mid accumulation, chunks fill in as passes complete
+		m_Checkpoint.Reset(Checkpoint::HashScene(scene, m_Settings.PhysicallyBased), Checkpoint::HashCamera(camera, width, height));
+	}
+}
+
+void Renderer::ResumeFromCheckpoint(const Camera& camera, const Scene& scene)
+{
+	uint64_t sceneHash = Checkpoint::HashScene(scene, m_Settings.PhysicallyBased);
+	uint64_t cameraHash = Checkpoint::HashCamera(camera, m_FinalImage->GetWidth(), m_FinalImage->GetHeight());
+
+	uint32_t sampleCount = m_Checkpoint.Restore(sceneHash, cameraHash, m_AccumulationBuffer, m_LuminanceSquaredBuffer);
+	if (sampleCount > 0)
+	{
+		m_FrameCount = sampleCount + 1;
+	}
+	else
+	{
+		m_Checkpoint.Reset(sceneHash, cameraHash);
+	}
+}
+
+void Renderer::PrepareRadianceCache(const Scene& scene)
+{
+	if (!m_Settings.CacheRadiance)
+		return;
+
+	m_RadianceCache.Allocate();
+
+	// Interactive edits go through ResetFrameCount, headless callers may pass another scene or
+	// edit one in place at the same address, so compare contents (a few hundred bytes to hash)
+	uint64_t sceneHash = Checkpoint::HashScene(scene, m_Settings.PhysicallyBased);
+	if (sceneHash != m_RadianceCacheSceneHash)
+	{
+		m_RadianceCache.Invalidate();
+		m_RadianceCacheSceneHash = sceneHash;
+	}
+}
+
+bool Renderer::RenderTiled(const Camera& camera, const Scene& scene, const TiledRenderSpecification& specification, TiledRenderStatus* status)
+{
+	m_CurrentScene = &scene;
+	m_CurrentCamera = &camera;
+	PrepareRadianceCache(scene);
+
+	const uint32_t width = specification.Width;
+	const uint32_t height = specification.Height;
+	const uint32_t tileSize = specification.TileSize;
+	const uint32_t samples = std::max(specification.SamplesPerPixel, 1u);
+	const uint32_t workerCount = specification.WorkerCount ? specification.WorkerCount : std::max(std::thread::hardware_concurrency(), 1u);
+
+	// Two output buffers per worker keep workers busy while the writer catches up
+	TileWriter writer;
+	if (!writer.Open(specification.OutputPath, width, height, tileSize, workerCount * 2))
+	{
+		return false;
+	}
+
+	const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+	const uint32_t tileCount = writer.GetTileCount();
+	if (status)
+	{
+		status->TilesDone = 0;
+		status->TileCount = tileCount;
+	}
+
+	const glm::mat4 inverseProjection = camera.CalculateInverseProjection(width, height);
+	std::atomic<uint32_t> nextTile = 0;
+
+	auto worker = [&]()
+		{
+			// Only in-flight tiles live in memory
+			std::vector<glm::vec4> accumulation(tileSize * tileSize);
+
+			// A failed write makes the file useless, so stop tracing as well
+			while (!(status && status->Cancel) && !writer.HasFailed())
+			{
+				uint32_t tileIndex = nextTile.fetch_add(1);
+				if (tileIndex >= tileCount)
+					break;
+
+				TileRegion tile;
+				tile.X = (tileIndex % tilesX) * tileSize;
+				tile.Y = (tileIndex / tilesX) * tileSize;
+				tile.Width = std::min(tileSize, width - tile.X);
+				tile.Height = std::min(tileSize, height - tile.Y);
+
+				std::fill(accumulation.begin(), accumulation.end(), glm::vec4(0.0f));
+				RenderTile(camera, inverseProjection, width, height, tile, 0, samples, accumulation.data(), tile.Width);
+
+				std::vector<uint32_t>* output = writer.AcquireBuffer();
+				for (uint32_t i = 0; i < tile.Width * tile.Height; i++)
+				{
+					glm::vec4 finalColor = glm::clamp(accumulation[i] / (float)samples, glm::vec4(0.0f), glm::vec4(1.0f));
+					(*output)[i] = Utility::ConvertToRGBA(finalColor);
+				}
+				writer.Submit(tileIndex, tile.Width, tile.Height, output);
+
+				if (status)
+				{
+					status->TilesDone++;
+				}
+			}
+		};
+
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(worker);
+	}
+	for (std::thread& thread : workers)
+	{
+		thread.join();
+	}
+
+	return writer.Close(!(status && status->Cancel));
+}
+
+void Renderer::RenderImage(const Camera& camera, const Scene& scene, uint32_t width, uint32_t height, uint32_t firstSample, uint32_t sampleCount,
+	glm::vec4* accumulation, uint32_t* image)
+{
+	ViewTarget view;
+	view.ViewCamera = &camera;
+	view.Width = width;
+	view.Height = height;
+	view.Accumulation = accumulation;
+	view.Image = image;
+
+	RenderViews(scene, &view, 1, firstSample, sampleCount);
+}
+
+void Renderer::RenderViews(const Scene& scene, const ViewTarget* views, uint32_t viewCount, uint32_t firstSample, uint32_t sampleCount)
+{
+	m_CurrentScene = &scene;
+	m_CurrentCamera = viewCount > 0 ? views[0].ViewCamera : nullptr;
+	PrepareRadianceCache(scene);
+	m_RaysTraced = 0;
+	m_CacheLookups = 0;
+	m_CacheHits = 0;
+
+	constexpr uint32_t tileSize = 32;
+
+	// One queue for all views so small views don't each pay for their own pass
+	std::vector<ViewTile> tiles;
+	std::vector<glm::mat4> inverseProjections(viewCount);
+	for (uint32_t i = 0; i < viewCount; i++)
+	{
+		const ViewTarget& view = views[i];
+		inverseProjections[i] = view.ViewCamera->CalculateInverseProjection(view.Width, view.Height);
+
+		for (uint32_t y = 0; y < view.Height; y += tileSize)
+		{
+			for (uint32_t x = 0; x < view.Width; x += tileSize)
+			{
+				tiles.push_back({ i, { x, y, std::min(tileSize, view.Width - x), std::min(tileSize, view.Height - y) } });
+			}
+		}
+	}
+
+	const float totalSamples = (float)(firstSample + sampleCount);
+
+	std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](const ViewTile& viewTile)
+		{
+			const ViewTarget& view = views[viewTile.ViewIndex];
+			const TileRegion& tile = viewTile.Region;
+
+			// Offsets in size_t, a full view can hold more pixels than a uint32 product safely indexes
+			glm::vec4* tileAccumulation = view.Accumulation + tile.X + (size_t)tile.Y * view.Width;
+			RenderTile(*view.ViewCamera, inverseProjections[viewTile.ViewIndex], view.Width, view.Height, tile, firstSample, sampleCount, tileAccumulation, view.Width, viewTile.ViewIndex);
+
+			if (!view.Image)
+				return;
+
+			// Resolve while the tile is still in cache
+			for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++)
+			{
+				for (uint32_t x = tile.X; x < tile.X + tile.Width; x++)
+				{
+					size_t index = x + (size_t)y * view.Width;
+					glm::vec4 finalColor = glm::clamp(view.Accumulation[index] / totalSamples, glm::vec4(0.0f), glm::vec4(1.0f));
+					view.Image[index] = Utility::ConvertToRGBA(finalColor);
+				}
+			}
+		});
+
+	m_TraceStatistics.RaysTraced = m_RaysTraced;
+	m_TraceStatistics.CacheLookups = m_CacheLookups;
+	m_TraceStatistics.CacheHits = m_CacheHits;
+}
+
+void Renderer::RenderTile(const Camera& camera, const glm::mat4& inverseProjection, uint32_t imageWidth, uint32_t imageHeight,
+	const TileRegion& tile, uint32_t firstSample, uint32_t sampleCount, glm::vec4* accumulation, uint32_t stride, uint32_t viewIndex)
+{
+	// Views of the same size would otherwise share a noise pattern, view 0 keeps the single view sequence
+	const uint32_t viewSeed = viewIndex * 0x9E3779B9u;
+	TraceStatistics statistics;
+
+	for (uint32_t y = 0; y < tile.Height; y++)
+	{
+		for (uint32_t x = 0; x < tile.Width; x++)
+		{
+			uint32_t pixelX = tile.X + x;
+			uint32_t pixelY = tile.Y + y;
+
+			Ray ray;
+			ray.Origin = camera.GetPosition();
+			ray.Direction = camera.CalculateRayDirection(inverseProjection, pixelX, pixelY, imageWidth, imageHeight);
+
+			// Camera rays are not jittered, so every sample of the pixel shares the primary hit
+			const HitEvent primaryHit = TraceRay(ray);
+			statistics.RaysTraced++;
+
+			glm::vec4 color(0.0f);
+			for (uint32_t sample = firstSample; sample < firstSample + sampleCount; sample++)
+			{
+				// Decorrelate samples without relying on the interactive frame counter
+				uint32_t seed = Utility::pcg_hash((pixelX + pixelY * imageWidth) ^ Utility::pcg_hash(sample + viewSeed));
+				color += TracePath(ray, seed, &primaryHit, statistics);
+			}
+
+			accumulation[x + y * stride] += color;
+		}
+	}
+
+	AddTraceStatistics(statistics);
+}
+
+float Renderer::CalculateSampleVariance(uint32_t samples) const
+{
+	// Average per-pixel variance of a single sample's luminance (lower = fewer spp to converge)
+	if (samples < 2)
+		return 0.0f;
+
+	const uint32_t width = m_FinalImage->GetWidth();
+	const float sampleCount = (float)samples;
+
+	float rowSum = std::transform_reduce(std::execution::par, m_VerticalPixelIterator.begin(), m_VerticalPixelIterator.end(), 0.0f, std::plus<>(), [this, width, sampleCount](uint32_t y)
+		{
+			float sum = 0.0f;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				float mean = Utility::Luminance(glm::vec3(m_AccumulationBuffer[x + y * width])) / sampleCount;
+				float meanSquared = m_LuminanceSquaredBuffer[x + y * width] / sampleCount;
+				sum += glm::max(meanSquared - mean * mean, 0.0f) * sampleCount / (sampleCount - 1.0f);
+			}
+			return sum;
+		});
+
+	return rowSum / (float)(width * m_FinalImage->GetHeight());
+}
+
 void Renderer::ChangeSphereColor(float colorR, float colorG, float colorB)
 {
 	SphereColor = { colorR, colorG, colorB };
@@ -185,7 +655,7 @@ void Renderer::ChangeLightPosition(float lightPosX, float lightPosY, float light
 	LightPosition = { lightPosX, lightPosY, lightPosZ };
 }
 
-glm::vec4 Renderer::RayGen(uint32_t x, uint32_t y)
+glm::vec4 Renderer::RayGen(uint32_t x, uint32_t y, TraceStatistics& statistics)
 {
 	// Define the ray
 	Ray ray;
@@ -196,18 +666,60 @@ glm::vec4 Renderer::RayGen(uint32_t x, uint32_t y)
 	const Light& light = m_CurrentScene->Lights[0];
 	glm::normalize(light.Position);
 
+	uint32_t seed = x + y * m_FinalImage->GetWidth() * m_FrameCount;
+
+	// Primary hits are reused while the camera and scene are unchanged
+	const HitEvent* primaryHit = nullptr;
+	if (m_Settings.CachePrimaryHits)
+	{
+		HitEvent& cachedHit = m_PrimaryHitCache[x + y * m_FinalImage->GetWidth()];
+		if (!m_PrimaryHitCacheValid)
+		{
+			cachedHit = TraceRay(ray);
+			statistics.RaysTraced++;
+		}
+		primaryHit = &cachedHit;
+	}
+
+	return TracePath(ray, seed, primaryHit, statistics);
+}
+
+glm::vec4 Renderer::TracePath(Ray ray, uint32_t seed, const HitEvent* primaryHit, TraceStatistics& statistics)
+{
 	glm::vec3 litColor = { 0.0f, 0.0f, 0.0f };
 	glm::vec3 throughput(1.0f);
-	int numBounces = 10;
+	constexpr int numBounces = 10;
 
-	uint32_t seed = x + y * m_FinalImage->GetWidth() * m_FrameCount;
+	// Diffuse vertices of this path, their outgoing radiance is known once the path ends
+	struct CacheVertex
+	{
+		glm::vec3 Position, Normal;
+		glm::vec3 LightBefore, Throughput;
+	};
+	CacheVertex cacheVertices[numBounces];
+	uint32_t cacheVertexCount = 0;
+
+	const bool cacheRadiance = m_Settings.CacheRadiance && m_Settings.PhysicallyBased;
+	const glm::vec3 cameraPosition = ray.Origin;
+	uint32_t raysTraced = 0;
+	bool cacheLookup = false, cacheHit = false;
 
 	for (int i = 0; i < numBounces; i++)
 	{
 		seed += i;
 
 		// Trace the ray
-		Renderer::HitEvent hitEvent = TraceRay(ray);
+		Renderer::HitEvent hitEvent;
+		if (i == 0 && primaryHit)
+		{
+			// Traced (and counted) once by the caller for every sample of the pixel
+			hitEvent = *primaryHit;
+		}
+		else
+		{
+			hitEvent = TraceRay(ray);
+			raysTraced++;
+		}
 
 		// If the ray did not hit anything, return background color
 		if (!hitEvent.Hit || hitEvent.HitDistance < 0)
@@ -217,11 +729,51 @@ glm::vec4 Renderer::RayGen(uint32_t x, uint32_t y)
 			break;
 		}
 
-		// Define the closest sphere
-		const Sphere& sphere = m_CurrentScene->Spheres[hitEvent.HitObjectIndex];
-		const Material& material = m_CurrentScene->Materials[sphere.MaterialIndex];
+		// Define the closest object's material
+		const Material& material = m_CurrentScene->Materials[hitEvent.MaterialIndex];
 		glm::vec3 sphereColor = material.Albedo;
 
+		if (m_Settings.PhysicallyBased)
+		{
+			bool diffuse = cacheRadiance && material.Roughness >= CacheRoughness && material.Metallic < 0.5f;
+			if (diffuse)
+			{
+				// From the second diffuse vertex on, low frequency indirect light can come from the cache
+				if (cacheVertexCount > 0)
+				{
+					cacheLookup = true;
+
+					glm::vec3 cachedRadiance;
+					if (m_RadianceCache.Lookup(hitEvent.WorldPosition, hitEvent.WorldNormal, cameraPosition, cachedRadiance))
+					{
+						litColor += cachedRadiance * throughput;
+						cacheHit = true;
+						break;
+					}
+				}
+
+				cacheVertices[cacheVertexCount++] = { hitEvent.WorldPosition, hitEvent.WorldNormal, litColor, throughput };
+			}
+
+			litColor += material.GetEmittingColor() * throughput;
+
+			// Importance sample the BSDF
+			glm::vec3 random = m_Settings.FastRandom
+				? glm::vec3(Utility::RandomFloat(seed), Utility::RandomFloat(seed), Utility::RandomFloat(seed))
+				: glm::vec3(Walnut::Random::Float(), Walnut::Random::Float(), Walnut::Random::Float());
+
+			BSDF::Sample sample = BSDF::SampleMaterial(material, hitEvent.WorldNormal, -ray.Direction, random);
+			float cosTheta = glm::dot(sample.Direction, hitEvent.WorldNormal);
+			if (sample.Pdf <= 0.0f || cosTheta <= 0.0f)
+				break;
+
+			throughput *= sample.Value * cosTheta / sample.Pdf;
+
+			ray.Origin = hitEvent.WorldPosition + hitEvent.WorldNormal * 0.001f;
+			ray.Direction = sample.Direction;
+			continue;
+		}
+
 		/*
 		// Calculate the light intensity and color
 		float lightIntensity = glm::max(glm::dot(hitEvent.WorldNormal, -light.Position), 0.0f); // Equiv to cos(theta)
@@ -257,30 +809,63 @@ glm::vec4 Renderer::RayGen(uint32_t x, uint32_t y)
 
 	}
 
+	// Everything gathered after a vertex, divided by the throughput that reached it, left that vertex towards the path
+	for (uint32_t i = 0; i < cacheVertexCount; i++)
+	{
+		const CacheVertex& vertex = cacheVertices[i];
+		if (Utility::Luminance(vertex.Throughput) < CacheMinThroughput)
+			continue;
+
+		glm::vec3 radiance = (litColor - vertex.LightBefore) / glm::max(vertex.Throughput, glm::vec3(1e-4f));
+		m_RadianceCache.Insert(vertex.Position, vertex.Normal, cameraPosition, radiance);
+	}
+
+	statistics.RaysTraced += raysTraced;
+	statistics.CacheLookups += cacheLookup ? 1 : 0;
+	statistics.CacheHits += cacheHit ? 1 : 0;
+
 	return glm::vec4(litColor, 1.0f);
 }
 
+void Renderer::AddTraceStatistics(const TraceStatistics& statistics)
+{
+	m_RaysTraced.fetch_add(statistics.RaysTraced, std::memory_order_relaxed);
+	m_CacheLookups.fetch_add(statistics.CacheLookups, std::memory_order_relaxed);
+	m_CacheHits.fetch_add(statistics.CacheHits, std::memory_order_relaxed);
+}
+
 Renderer::HitEvent Renderer::TraceRay(const Ray& ray)
 {
-	// No Sphere in scene
-	if (m_CurrentScene->Spheres.size() == 0)
+	// Each primitive type is intersected in its own loop over a contiguous array
+	Intersection closest;
+	IntersectPlanes(ray, closest);
+	IntersectSpheres(ray, closest);
+	IntersectBoxes(ray, closest);
+	IntersectDiscs(ray, closest);
+
+	// Nothing was hit
+	if (closest.ObjectIndex == std::numeric_limits<uint32_t>::max())
 	{
 		return Miss(ray);
 	}
 
-	uint32_t closestSphere = std::numeric_limits<uint32_t>::max();
-	float closestDistance = std::numeric_limits<float>::max();
+	return ClosestHit(ray, closest);
+}
+
+void Renderer::IntersectSpheres(const Ray& ray, Intersection& closest) const
+{
+	const std::vector<Sphere>& spheres = m_CurrentScene->Spheres;
+	float a = glm::dot(ray.Direction, ray.Direction);
 
 	// Loop through all the spheres in the scene
-	for (size_t i = 0; i < m_CurrentScene->Spheres.size(); i++)
+	for (size_t i = 0; i < spheres.size(); i++)
 	{
-		const Sphere& sphere = m_CurrentScene->Spheres[i];
+		const Sphere& sphere = spheres[i];
 
 		// Calculate translated ray origin (based on Sphere Origin)
 		glm::vec3 origin = ray.Origin - sphere.Position;
 
 		// Calculate the ray distance from the camera to the sphere
-		float a = glm::dot(ray.Direction, ray.Direction);
 		float b = 2.0f * glm::dot(origin, ray.Direction); 
 		float c = glm::dot(origin, origin) - sphere.Radius * sphere.Radius;
 
@@ -292,45 +877,166 @@ Renderer::HitEvent Renderer::TraceRay(const Ray& ray)
 			continue;
 		}
 
-		// Calculate the distance from the camera to the sphere
-		float distance[2] = {(-b - sqrt(discriminant)) / (2.0f * a), (-b + sqrt(discriminant)) / (2.0f * a)};
+		// Calculate the distance from the camera to the sphere (near intersection only)
+		float distance = (-b - sqrt(discriminant)) / (2.0f * a);
 
 		// Update the closest sphere
-		if (distance[0] > 0.0f && distance[0] < closestDistance)
+		if (distance > 0.0f && distance < closest.Distance)
 		{
-			closestDistance = distance[0];
-			closestSphere = i;
+			closest.Distance = distance;
+			closest.ObjectIndex = (uint32_t)i;
+			closest.Type = ObjectType::Sphere;
 		}
 	}
+}
+
+void Renderer::IntersectPlanes(const Ray& ray, Intersection& closest) const
+{
+	const std::vector<Plane>& planes = m_CurrentScene->Planes;
 
-	// No sphere was hit
-	if (closestSphere == std::numeric_limits<uint32_t>::max())
+	for (size_t i = 0; i < planes.size(); i++)
 	{
-		return Miss(ray);
+		const Plane& plane = planes[i];
+
+		// Parallel rays never hit the plane
+		float denominator = glm::dot(plane.Normal, ray.Direction);
+		if (std::abs(denominator) < 1e-6f)
+		{
+			continue;
+		}
+
+		float distance = glm::dot(plane.Position - ray.Origin, plane.Normal) / denominator;
+		if (distance <= 0.0f || distance >= closest.Distance)
+		{
+			continue;
+		}
+
+		// Finite planes are rectangles spanned by the plane's tangent axes
+		if (plane.Extent.x > 0.0f && plane.Extent.y > 0.0f)
+		{
+			glm::vec3 local = ray.Origin + ray.Direction * distance - plane.Position;
+			if (std::abs(glm::dot(local, plane.GetTangent())) > plane.Extent.x || std::abs(glm::dot(local, plane.GetBitangent())) > plane.Extent.y)
+			{
+				continue;
+			}
+		}
+
+		closest.Distance = distance;
+		closest.ObjectIndex = (uint32_t)i;
+		closest.Type = ObjectType::Plane;
 	}
+}
+
+void Renderer::IntersectBoxes(const Ray& ray, Intersection& closest) const
+{
+	const std::vector<Box>& boxes = m_CurrentScene->Boxes;
+	glm::vec3 inverseDirection = 1.0f / ray.Direction;
 
-	return ClosestHit(ray, closestSphere, closestDistance);
+	// Slab test
+	for (size_t i = 0; i < boxes.size(); i++)
+	{
+		const Box& box = boxes[i];
+
+		glm::vec3 t0 = (box.Min - ray.Origin) * inverseDirection;
+		glm::vec3 t1 = (box.Max - ray.Origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+
+		float entry = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+		float exit = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+
+		// Only count hits from outside the box, like spheres
+		if (entry > exit || entry <= 0.0f || entry >= closest.Distance)
+		{
+			continue;
+		}
+
+		closest.Distance = entry;
+		closest.ObjectIndex = (uint32_t)i;
+		closest.Type = ObjectType::Box;
+	}
 }
 
+void Renderer::IntersectDiscs(const Ray& ray, Intersection& closest) const
+{
+	const std::vector<Disc>& discs = m_CurrentScene->Discs;
+
+	for (size_t i = 0; i < discs.size(); i++)
+	{
+		const Disc& disc = discs[i];
+
+		float denominator = glm::dot(disc.Normal, ray.Direction);
+		if (std::abs(denominator) < 1e-6f)
+		{
+			continue;
+		}
+
+		float distance = glm::dot(disc.Position - ray.Origin, disc.Normal) / denominator;
+		if (distance <= 0.0f || distance >= closest.Distance)
+		{
+			continue;
+		}
+
+		glm::vec3 local = ray.Origin + ray.Direction * distance - disc.Position;
+		if (glm::dot(local, local) > disc.Radius * disc.Radius)
+		{
+			continue;
+		}
+
+		closest.Distance = distance;
+		closest.ObjectIndex = (uint32_t)i;
+		closest.Type = ObjectType::Disc;
+	}
+}
 
-Renderer::HitEvent Renderer::ClosestHit(const class Ray& ray, uint32_t objectIndex, float hitDistance)
+Renderer::HitEvent Renderer::ClosestHit(const class Ray& ray, const Intersection& intersection)
 {
 	// Create a hit event
 	Renderer::HitEvent hitEvent;
 	hitEvent.Hit = true;
-	hitEvent.HitObjectIndex = objectIndex;
-	hitEvent.HitDistance = hitDistance;
-
-	// Get the closest sphere
-	const Sphere& closestSphere = m_CurrentScene->Spheres[objectIndex];
-
-	// Calculate the intersection point
-	glm::vec3 origin = ray.Origin - closestSphere.Position; // Translate to sphere space
-	hitEvent.WorldPosition = origin + ray.Direction * hitDistance;
-	hitEvent.WorldNormal = glm::normalize(hitEvent.WorldPosition);
+	hitEvent.HitObjectIndex = intersection.ObjectIndex;
+	hitEvent.HitObjectType = intersection.Type;
+	hitEvent.HitDistance = intersection.Distance;
+	hitEvent.WorldPosition = ray.Origin + ray.Direction * intersection.Distance;
 
-	// Translate back to world space
-	hitEvent.WorldPosition += closestSphere.Position;
+	switch (intersection.Type)
+	{
+		case ObjectType::Sphere:
+		{
+			const Sphere& sphere = m_CurrentScene->Spheres[intersection.ObjectIndex];
+			hitEvent.WorldNormal = glm::normalize(hitEvent.WorldPosition - sphere.Position);
+			hitEvent.MaterialIndex = sphere.MaterialIndex;
+			break;
+		}
+		case ObjectType::Plane:
+		{
+			// Planes are two-sided, face the normal towards the ray
+			const Plane& plane = m_CurrentScene->Planes[intersection.ObjectIndex];
+			hitEvent.WorldNormal = glm::dot(plane.Normal, ray.Direction) < 0.0f ? plane.Normal : -plane.Normal;
+			hitEvent.MaterialIndex = plane.MaterialIndex;
+			break;
+		}
+		case ObjectType::Box:
+		{
+			// The face is the axis where the hit point is furthest out relative to the half size
+			const Box& box = m_CurrentScene->Boxes[intersection.ObjectIndex];
+			glm::vec3 local = (hitEvent.WorldPosition - (box.Min + box.Max) * 0.5f) / ((box.Max - box.Min) * 0.5f);
+			glm::vec3 magnitude = glm::abs(local);
+
+			int axis = magnitude.x > magnitude.y ? (magnitude.x > magnitude.z ? 0 : 2) : (magnitude.y > magnitude.z ? 1 : 2);
+			hitEvent.WorldNormal = glm::vec3(0.0f);
+			hitEvent.WorldNormal[axis] = local[axis] > 0.0f ? 1.0f : -1.0f;
+			hitEvent.MaterialIndex = box.MaterialIndex;
+			break;
+		}
+		case ObjectType::Disc:
+		{
+			const Disc& disc = m_CurrentScene->Discs[intersection.ObjectIndex];
+			hitEvent.WorldNormal = glm::dot(disc.Normal, ray.Direction) < 0.0f ? disc.Normal : -disc.Normal;
+			hitEvent.MaterialIndex = disc.MaterialIndex;
+			break;
+		}
+	}
 
 	// Return the hit event
 	return hitEvent;
@@ -2,9 +2,15 @@
 
 #include "Walnut/Image.h"
 
+#include "Checkpoint.h"
+#include "RadianceCache.h"
+
 #include <memory>
 #include <glm/glm.hpp>
 #include <vector>
+#include <limits>
+#include <string>
+#include <atomic>
 
 typedef struct Settings Settings;
 
@@ -19,35 +25,170 @@ public:
 		void ChangeLightPosition(float lightPosX, float lightPosY, float lightPosZ);
 
 		std::shared_ptr<Walnut::Image> GetFinalImage() const { return m_FinalImage; }
-		void ResetFrameCount() { m_FrameCount = 1; }
+		void ResetFrameCount() { m_FrameCount = 1; m_RowCursor = 0; m_PrimaryHitCacheValid = false; m_RadianceCache.Invalidate(); }
 
 		struct Settings
 		{
 			bool Accumulate = true;
 			bool FastRandom = true;
+			bool PhysicallyBased = true; // GGX metallic/roughness BSDF instead of the roughness mix
+			bool MeasureVariance = false;
+			bool CachePrimaryHits = true; // Reuse first intersections while the camera is still
+			bool Checkpoint = false; // Persist accumulation so it survives crashes and resizes
+			bool TimeBudget = false; // Trace as many samples per frame as fit in FrameBudget
+			float FrameBudget = 16.0f; // Milliseconds
+			bool CacheRadiance = false; // End paths at later diffuse vertices with cached radiance (physically based only)
 		};
 		Settings& GetSettings() { return m_Settings; }
+		float GetSampleVariance() const { return m_SampleVariance; }
+		float GetSamplesPerFrame() const { return m_SamplesPerFrame; } // Samples per pixel traced by the last Render, fractional for partial passes
+		uint32_t GetSampleCount() const { return m_FrameCount - 1; } // Completed passes
+
+		struct TraceStatistics
+		{
+			uint64_t RaysTraced = 0;
+			uint64_t CacheLookups = 0;
+			uint64_t CacheHits = 0;
+
+			TraceStatistics& operator+=(const TraceStatistics& other)
+			{
+				RaysTraced += other.RaysTraced;
+				CacheLookups += other.CacheLookups;
+				CacheHits += other.CacheHits;
+				return *this;
+			}
+		};
+		const TraceStatistics& GetTraceStatistics() const { return m_TraceStatistics; } // Last Render or RenderViews call
+
+		/* Offline tiled rendering, memory use scales with tile size and worker count only */
+		struct TiledRenderSpecification
+		{
+			std::string OutputPath = "Render.srtc";
+			uint32_t Width = 8192, Height = 8192;
+			uint32_t TileSize = 256;
+			uint32_t SamplesPerPixel = 256;
+			uint32_t WorkerCount = 0; // 0 = one per hardware thread
+		};
+
+		struct TiledRenderStatus
+		{
+			std::atomic<bool> Running{ false };
+			std::atomic<bool> Cancel{ false };
+			std::atomic<uint32_t> TilesDone{ 0 };
+			std::atomic<uint32_t> TileCount{ 0 };
+		};
+
+		// Blocks until every tile is written, returns false if cancelled or the output file could not be written
+		bool RenderTiled(const class Camera& camera, const class Scene& scene, const TiledRenderSpecification& specification, TiledRenderStatus* status = nullptr);
+
+		// Headless progressive rendering: adds sampleCount samples per pixel starting at firstSample,
+		// image (optional) receives the resolved RGBA result
+		void RenderImage(const class Camera& camera, const class Scene& scene, uint32_t width, uint32_t height, uint32_t firstSample, uint32_t sampleCount,
+			glm::vec4* accumulation, uint32_t* image = nullptr);
+
+		/* Batch rendering, tiles of every view share one parallel pass over the scene */
+		struct ViewTarget
+		{
+			const class Camera* ViewCamera = nullptr;
+			uint32_t Width = 0, Height = 0;
+			glm::vec4* Accumulation = nullptr; // Width * Height, owned by the caller
+			uint32_t* Image = nullptr; // Optional resolved RGBA
+		};
+
+		// Same progressive contract as RenderImage, applied to every view
+		void RenderViews(const class Scene& scene, const ViewTarget* views, uint32_t viewCount, uint32_t firstSample, uint32_t sampleCount);
 
 private:
+	enum class ObjectType : uint8_t
+	{
+		Sphere, Plane, Box, Disc
+	};
+
 	struct HitEvent
 	{
 		bool Hit = false;
+		ObjectType HitObjectType = ObjectType::Sphere;
 		uint32_t HitObjectIndex;
+		int MaterialIndex;
 		float HitDistance;
 		glm::vec3 WorldPosition;
 		glm::vec3 WorldNormal;
 	};
 
-	glm::vec4 RayGen(uint32_t x, uint32_t y);
+	struct TileRegion
+	{
+		uint32_t X = 0, Y = 0;
+		uint32_t Width = 0, Height = 0;
+	};
+
+	struct ViewTile
+	{
+		uint32_t ViewIndex = 0;
+		TileRegion Region;
+	};
+
+	struct Intersection
+	{
+		float Distance = std::numeric_limits<float>::max();
+		uint32_t ObjectIndex = std::numeric_limits<uint32_t>::max();
+		ObjectType Type = ObjectType::Sphere;
+	};
+
+	glm::vec4 RayGen(uint32_t x, uint32_t y, TraceStatistics& statistics);
+	glm::vec4 TracePath(class Ray ray, uint32_t seed, const HitEvent* primaryHit, TraceStatistics& statistics);
+	void AddTraceStatistics(const TraceStatistics& statistics);
+	void RenderTile(const class Camera& camera, const glm::mat4& inverseProjection, uint32_t imageWidth, uint32_t imageHeight,
+		const TileRegion& tile, uint32_t firstSample, uint32_t sampleCount, glm::vec4* accumulation, uint32_t stride, uint32_t viewIndex = 0);
 	HitEvent TraceRay(const class Ray& ray);
-	HitEvent ClosestHit(const class Ray& ray, uint32_t objectIndex, float hitDistance);
+	void IntersectSpheres(const class Ray& ray, Intersection& closest) const;
+	void IntersectPlanes(const class Ray& ray, Intersection& closest) const;
+	void IntersectBoxes(const class Ray& ray, Intersection& closest) const;
+	void IntersectDiscs(const class Ray& ray, Intersection& closest) const;
+	HitEvent ClosestHit(const class Ray& ray, const Intersection& intersection);
 	HitEvent Miss(const class Ray& ray);
+	void RenderWithinBudget(uint64_t& pixelsTraced);
+	void RenderRows(uint32_t firstRow, uint32_t rowCount);
+	void CompletePass();
+	void ResolveRows(uint32_t firstRow, uint32_t rowCount);
+	float CalculateSampleVariance(uint32_t samples) const;
+	void UpdateCheckpoint(const class Camera& camera, const class Scene& scene);
+	void ResumeFromCheckpoint(const class Camera& camera, const class Scene& scene);
+	void PrepareRadianceCache(const class Scene& scene);
 
 private:
 	std::shared_ptr<Walnut::Image> m_FinalImage;
 	uint32_t* m_ImageData = nullptr;
 	glm::vec4* m_AccumulationBuffer = nullptr;
+	float* m_LuminanceSquaredBuffer = nullptr;
 	uint32_t m_FrameCount = 1;
+	float m_SampleVariance = 0.0f;
+
+	// Budgeted frames may end mid pass, rows above the cursor already have sample m_FrameCount
+	static constexpr uint32_t MinimumBandRows = 8;
+	uint32_t m_RowCursor = 0;
+	float m_SampleCost = 0.0f; // Milliseconds per pixel sample, moving average
+	float m_UploadTime = 0.0f; // Milliseconds for the image upload, moving average
+	float m_SamplesPerFrame = 0.0f;
+
+	// Camera rays are not jittered, so every frame hits the same primary points
+	std::vector<HitEvent> m_PrimaryHitCache;
+	bool m_PrimaryHitCacheValid = false;
+
+	Checkpoint m_Checkpoint;
+	static constexpr uint32_t CheckpointSettleSamples = 8;
+	std::string m_CheckpointPath;
+	std::string m_PreviousCheckpointPath;
+	std::string m_FailedCheckpointPath;
+
+	RadianceCache m_RadianceCache;
+	uint64_t m_RadianceCacheSceneHash = 0;
+	static constexpr float CacheRoughness = 0.6f; // Rougher dielectrics count as diffuse
+	static constexpr float CacheMinThroughput = 0.05f; // Below this the vertex radiance estimate is too noisy to insert
+
+	std::atomic<uint64_t> m_RaysTraced{ 0 };
+	std::atomic<uint64_t> m_CacheLookups{ 0 };
+	std::atomic<uint64_t> m_CacheHits{ 0 };
+	TraceStatistics m_TraceStatistics;
 
 	std::vector<uint32_t> m_HorizontalPixelIterator;
 	std::vector<uint32_t> m_VerticalPixelIterator;
@@ -4,6 +4,9 @@
 #include <glm/glm.hpp>
 
 typedef struct Sphere Sphere;
+typedef struct Plane Plane;
+typedef struct Box Box;
+typedef struct Disc Disc;
 typedef struct Scene Scene;
 typedef struct Light Light;
 typedef struct Material Material;
@@ -11,6 +14,9 @@ typedef struct Material Material;
 struct Scene
 {
 	std::vector<Sphere> Spheres;
+	std::vector<Plane> Planes;
+	std::vector<Box> Boxes;
+	std::vector<Disc> Discs;
 	std::vector<Light> Lights;
 	std::vector<Material> Materials;
 };
@@ -34,6 +40,39 @@ struct Sphere
 	int MaterialIndex;
 };
 
+struct Plane
+{
+	glm::vec3 Position{ 0.0f, 0.0f, 0.0f };
+	glm::vec3 Normal{ 0.0f, 1.0f, 0.0f };
+	glm::vec2 Extent{ 0.0f, 0.0f }; // Half size along the tangent axes (0 = infinite)
+
+	int MaterialIndex;
+
+	glm::vec3 GetTangent() const
+	{
+		glm::vec3 reference = glm::abs(Normal.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		return glm::normalize(glm::cross(reference, Normal));
+	}
+	glm::vec3 GetBitangent() const { return glm::cross(Normal, GetTangent()); }
+};
+
+struct Box
+{
+	glm::vec3 Min{ -0.5f, -0.5f, -0.5f };
+	glm::vec3 Max{ 0.5f, 0.5f, 0.5f };
+
+	int MaterialIndex;
+};
+
+struct Disc
+{
+	glm::vec3 Position{ 0.0f, 0.0f, 0.0f };
+	glm::vec3 Normal{ 0.0f, 1.0f, 0.0f };
+	float Radius = 0.5f;
+
+	int MaterialIndex;
+};
+
 struct Light
 {
 	glm::vec3 Position{ 0.0f, 0.0f, 0.0f };
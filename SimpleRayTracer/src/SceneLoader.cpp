@@ -0,0 +1,156 @@
+#include "SceneLoader.h"
+
+#include <fstream>
+#include <sstream>
+
+Scene SceneLoader::CreateDefaultScene()
+{
+	Scene scene;
+
+	Material& ground = scene.Materials.emplace_back();
+	ground.Albedo = { 0.2f, 0.2f, 0.2f };
+	ground.Roughness = 0.5f;
+	ground.Metallic = 0.0f;
+
+	Material& floatingSphere = scene.Materials.emplace_back();
+	floatingSphere.Albedo = { 0.2f, 0.55f, 0.6f };
+	floatingSphere.Roughness = 0.2f;
+	floatingSphere.Metallic = 1.0f;
+
+	Material& EmissiveSphere = scene.Materials.emplace_back();
+	EmissiveSphere.Albedo = { 0.9f, 0.6f, 0.4f };
+	EmissiveSphere.Roughness = 0.1f;
+	EmissiveSphere.EmissionColor = { 0.9f, 0.6f, 0.4f };
+	EmissiveSphere.EmissionStrength = 6.0f;
+
+	Material& SideSphere = scene.Materials.emplace_back();
+	SideSphere.Albedo = { 0.8f, 0.3f, 0.2f };
+	SideSphere.Roughness = 0.28f;
+	SideSphere.Metallic = 1.0f;
+
+	Material& BackSphere = scene.Materials.emplace_back();
+	BackSphere.Albedo = { 0.2f, 0.8f, 0.1f };
+	BackSphere.Roughness = 1.0f;
+
+	Plane FloorPlane;
+	FloorPlane.Position = { 0.0f, -0.5f, 0.0f };
+	FloorPlane.Normal = { 0.0f, 1.0f, 0.0f };
+	FloorPlane.MaterialIndex = 0;
+	scene.Planes.push_back(FloorPlane);
+
+	Sphere sphere;
+	sphere.Position = { 0.0f, 0.0f, 0.0f };
+	sphere.Radius = 0.5f;
+	sphere.MaterialIndex = 1;
+	scene.Spheres.push_back(sphere);
+
+	Sphere sphere2;
+	sphere2.Position = { 2.0f, 2.5f, 0.0f };
+	sphere2.Radius = 1.0f;
+	sphere2.MaterialIndex = 2;
+	scene.Spheres.push_back(sphere2);
+
+	Sphere sphere3;
+	sphere3.Position = { -2.0f, 0.49f, 1.0f };
+	sphere3.Radius = 1.0f;
+	sphere3.MaterialIndex = 3;
+	scene.Spheres.push_back(sphere3);
+
+	Sphere sphere4;
+	sphere4.Position = {-1.5f, 0.31f, -6.0f };
+	sphere4.Radius = 1.0f;
+	sphere4.MaterialIndex = 4;
+	scene.Spheres.push_back(sphere4);
+
+	Light light;
+	light.Position = { -1.0f, -1.0f, -1.0f };
+	scene.Lights.push_back(light);
+
+	return scene;
+}
+
+bool SceneLoader::LoadFromFile(const std::string& path, Scene& scene, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	scene = Scene();
+
+	std::string line;
+	for (uint32_t lineNumber = 1; std::getline(file, line); lineNumber++)
+	{
+		std::istringstream stream(line.substr(0, line.find('#')));
+
+		std::string type;
+		if (!(stream >> type))
+			continue;
+
+		bool valid = false;
+		if (type == "material")
+		{
+			Material& material = scene.Materials.emplace_back();
+			valid = (bool)(stream >> material.Albedo.r >> material.Albedo.g >> material.Albedo.b >> material.Roughness >> material.Metallic);
+			if (valid && (stream >> material.EmissionColor.r))
+			{
+				valid = (bool)(stream >> material.EmissionColor.g >> material.EmissionColor.b >> material.EmissionStrength);
+			}
+		}
+		else if (type == "sphere")
+		{
+			Sphere& sphere = scene.Spheres.emplace_back();
+			valid = (bool)(stream >> sphere.Position.x >> sphere.Position.y >> sphere.Position.z >> sphere.Radius >> sphere.MaterialIndex);
+		}
+		else if (type == "plane")
+		{
+			Plane& plane = scene.Planes.emplace_back();
+			valid = (bool)(stream >> plane.Position.x >> plane.Position.y >> plane.Position.z >> plane.Normal.x >> plane.Normal.y >> plane.Normal.z >> plane.MaterialIndex);
+			if (valid && (stream >> plane.Extent.x))
+			{
+				valid = (bool)(stream >> plane.Extent.y);
+			}
+			plane.Normal = glm::normalize(plane.Normal);
+		}
+		else if (type == "box")
+		{
+			Box& box = scene.Boxes.emplace_back();
+			valid = (bool)(stream >> box.Min.x >> box.Min.y >> box.Min.z >> box.Max.x >> box.Max.y >> box.Max.z >> box.MaterialIndex);
+		}
+		else if (type == "disc")
+		{
+			Disc& disc = scene.Discs.emplace_back();
+			valid = (bool)(stream >> disc.Position.x >> disc.Position.y >> disc.Position.z >> disc.Normal.x >> disc.Normal.y >> disc.Normal.z >> disc.Radius >> disc.MaterialIndex);
+			disc.Normal = glm::normalize(disc.Normal);
+		}
+		else if (type == "light")
+		{
+			Light& light = scene.Lights.emplace_back();
+			valid = (bool)(stream >> light.Position.x >> light.Position.y >> light.Position.z);
+		}
+
+		if (!valid)
+		{
+			error = path + ":" + std::to_string(lineNumber) + ": invalid '" + type + "' line";
+			return false;
+		}
+	}
+
+	// Every object has to reference an existing material
+	auto validMaterial = [&scene](int index) { return index >= 0 && index < (int)scene.Materials.size(); };
+	bool materialsValid = true;
+	for (const Sphere& sphere : scene.Spheres) materialsValid &= validMaterial(sphere.MaterialIndex);
+	for (const Plane& plane : scene.Planes) materialsValid &= validMaterial(plane.MaterialIndex);
+	for (const Box& box : scene.Boxes) materialsValid &= validMaterial(box.MaterialIndex);
+	for (const Disc& disc : scene.Discs) materialsValid &= validMaterial(disc.MaterialIndex);
+
+	if (!materialsValid)
+	{
+		error = path + ": material index out of range";
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <string>
+
+/*
+*		Scene text format, one primitive per line ('#' starts a comment)
+*		* material <r> <g> <b> <roughness> <metallic> [<emission r> <g> <b> <strength>]
+*		* sphere <x> <y> <z> <radius> <material>
+*		* plane <x> <y> <z> <normal x> <y> <z> <material> [<extent x> <y>]
+*		* box <min x> <y> <z> <max x> <y> <z> <material>
+*		* disc <x> <y> <z> <normal x> <y> <z> <radius> <material>
+*		* light <x> <y> <z>
+*/
+
+namespace SceneLoader
+{
+	Scene CreateDefaultScene();
+
+	// Returns false and fills error if the file cannot be read or a line is malformed
+	bool LoadFromFile(const std::string& path, Scene& scene, std::string& error);
+}
@@ -0,0 +1,264 @@
+#include "SequenceRenderer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <thread>
+
+namespace Utility
+{
+	// Finds the keyframes around time and the blend factor between them (keys sorted by time)
+	template<typename T>
+	static float FindKeyframes(const std::vector<const T*>& keys, float time, const T*& from, const T*& to)
+	{
+		from = keys.front();
+		to = keys.front();
+		for (const T* key : keys)
+		{
+			to = key;
+			if (key->Time >= time)
+				break;
+			from = key;
+		}
+
+		float span = to->Time - from->Time;
+		return span > 0.0f ? glm::clamp((time - from->Time) / span, 0.0f, 1.0f) : 0.0f;
+	}
+
+	// Gathers the keyframes that animate one object, ordered by time
+	template<typename T, typename Predicate>
+	static std::vector<const T*> SelectKeyframes(const std::vector<T>& keyframes, Predicate predicate)
+	{
+		std::vector<const T*> keys;
+		for (const T& key : keyframes)
+		{
+			if (predicate(key))
+				keys.push_back(&key);
+		}
+
+		std::stable_sort(keys.begin(), keys.end(), [](const T* a, const T* b) { return a->Time < b->Time; });
+		return keys;
+	}
+}
+
+bool SequenceRenderer::Render(const Scene& scene, const Camera& camera, const Specification& specification, Status* status)
+{
+	const uint32_t pixelCount = specification.Width * specification.Height;
+	const uint32_t samples = std::max(specification.SamplesPerPixel, 1u);
+
+	std::filesystem::path directory = std::filesystem::path(specification.OutputPrefix).parent_path();
+	if (!directory.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+	}
+
+	// Buffers are allocated once and reused for every frame
+	m_Accumulation.resize(pixelCount);
+	m_Images.assign(QueueDepth, std::vector<uint32_t>(pixelCount));
+	m_FreeImages.clear();
+	for (std::vector<uint32_t>& image : m_Images)
+	{
+		m_FreeImages.push_back(&image);
+	}
+	m_Pending.clear();
+	m_Closing = false;
+	m_Failed = false;
+
+	if (status)
+	{
+		status->FramesDone = 0;
+		status->FrameCount = specification.FrameCount;
+	}
+
+	std::thread writer(&SequenceRenderer::WriterThread, this, std::cref(specification), status);
+
+	std::future<Frame> nextFrame;
+	if (specification.FrameCount > 0)
+	{
+		nextFrame = std::async(std::launch::async, &SequenceRenderer::PrepareFrame, std::cref(scene), std::cref(camera), std::cref(specification), 0u);
+	}
+
+	for (uint32_t frameIndex = 0; frameIndex < specification.FrameCount; frameIndex++)
+	{
+		// A failed write ends the sequence, the remaining frames would be traced for nothing
+		if ((status && status->Cancel) || m_Failed)
+			break;
+
+		Frame frame = nextFrame.get();
+
+		// Overlap the setup of the next frame with tracing this one
+		if (frameIndex + 1 < specification.FrameCount)
+		{
+			nextFrame = std::async(std::launch::async, &SequenceRenderer::PrepareFrame, std::cref(scene), std::cref(camera), std::cref(specification), frameIndex + 1);
+		}
+
+		// Waits only if the I/O thread is QueueDepth frames behind
+		std::vector<uint32_t>* image;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_ImageAvailable.wait(lock, [this]() { return !m_FreeImages.empty(); });
+			image = m_FreeImages.back();
+			m_FreeImages.pop_back();
+		}
+
+		std::fill(m_Accumulation.begin(), m_Accumulation.end(), glm::vec4(0.0f));
+		m_Renderer.RenderImage(frame.FrameCamera, frame.FrameScene, specification.Width, specification.Height, 0, samples, m_Accumulation.data(), image->data());
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Pending.push_back({ frameIndex, image });
+		}
+		m_FrameAvailable.notify_one();
+	}
+
+	// A cancelled run may leave a prepared frame behind
+	if (nextFrame.valid())
+	{
+		nextFrame.wait();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Closing = true;
+	}
+	m_FrameAvailable.notify_one();
+	writer.join();
+
+	return !m_Failed;
+}
+
+SequenceRenderer::Frame SequenceRenderer::PrepareFrame(const Scene& scene, const Camera& camera, const Specification& specification, uint32_t frameIndex)
+{
+	const float time = (float)frameIndex / specification.FrameRate;
+
+	Frame frame;
+	frame.FrameScene = scene;
+
+	// Sphere keyframes
+	for (uint32_t i = 0; i < (uint32_t)frame.FrameScene.Spheres.size(); i++)
+	{
+		std::vector<const SphereKeyframe*> keys = Utility::SelectKeyframes(specification.SphereKeyframes, [i](const SphereKeyframe& key) { return key.SphereIndex == i; });
+		if (keys.empty())
+			continue;
+
+		const SphereKeyframe* from;
+		const SphereKeyframe* to;
+		float t = Utility::FindKeyframes(keys, time, from, to);
+
+		Sphere& sphere = frame.FrameScene.Spheres[i];
+		sphere.Position = glm::mix(from->Position, to->Position, t);
+		sphere.Radius = glm::mix(from->Radius, to->Radius, t);
+	}
+
+	// Material keyframes
+	for (uint32_t i = 0; i < (uint32_t)frame.FrameScene.Materials.size(); i++)
+	{
+		std::vector<const MaterialKeyframe*> keys = Utility::SelectKeyframes(specification.MaterialKeyframes, [i](const MaterialKeyframe& key) { return key.MaterialIndex == i; });
+		if (keys.empty())
+			continue;
+
+		const MaterialKeyframe* from;
+		const MaterialKeyframe* to;
+		float t = Utility::FindKeyframes(keys, time, from, to);
+
+		Material& material = frame.FrameScene.Materials[i];
+		material.Albedo = glm::mix(from->Properties.Albedo, to->Properties.Albedo, t);
+		material.Roughness = glm::mix(from->Properties.Roughness, to->Properties.Roughness, t);
+		material.Metallic = glm::mix(from->Properties.Metallic, to->Properties.Metallic, t);
+		material.EmissionColor = glm::mix(from->Properties.EmissionColor, to->Properties.EmissionColor, t);
+		material.EmissionStrength = glm::mix(from->Properties.EmissionStrength, to->Properties.EmissionStrength, t);
+	}
+
+	// Camera keyframes, the sequence keeps the interactive camera's lens but not its
+	// viewport sized ray directions, RenderImage generates rays at the frame size
+	frame.FrameCamera = Camera(camera.GetVerticalFOV(), camera.GetNearClip(), camera.GetFarClip());
+	glm::vec3 position = camera.GetPosition();
+	glm::vec3 direction = camera.GetDirection();
+
+	std::vector<const CameraKeyframe*> keys = Utility::SelectKeyframes(specification.CameraKeyframes, [](const CameraKeyframe&) { return true; });
+	if (!keys.empty())
+	{
+		const CameraKeyframe* from;
+		const CameraKeyframe* to;
+		float t = Utility::FindKeyframes(keys, time, from, to);
+
+		position = glm::mix(from->Position, to->Position, t);
+		direction = glm::mix(from->Direction, to->Direction, t);
+	}
+	frame.FrameCamera.SetPose(position, direction);
+
+	return frame;
+}
+
+void SequenceRenderer::WriterThread(const Specification& specification, Status* status)
+{
+	// Encoding scratch buffer, reused for every frame
+	std::vector<uint8_t> encoded;
+
+	while (true)
+	{
+		EncodedFrame frame;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_FrameAvailable.wait(lock, [this]() { return !m_Pending.empty() || m_Closing; });
+
+			if (m_Pending.empty())
+				return;
+
+			frame = m_Pending.front();
+			m_Pending.pop_front();
+		}
+
+		// Binary PPM, rows flipped since the renderer's origin is bottom left
+		char header[64];
+		int headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", specification.Width, specification.Height);
+
+		encoded.resize(headerSize + (size_t)specification.Width * specification.Height * 3);
+		memcpy(encoded.data(), header, headerSize);
+
+		uint8_t* pixel = encoded.data() + headerSize;
+		for (uint32_t y = specification.Height; y-- > 0;)
+		{
+			const uint32_t* row = frame.Image->data() + (size_t)y * specification.Width;
+			for (uint32_t x = 0; x < specification.Width; x++)
+			{
+				*pixel++ = (uint8_t)(row[x] & 0xFF);
+				*pixel++ = (uint8_t)((row[x] >> 8) & 0xFF);
+				*pixel++ = (uint8_t)((row[x] >> 16) & 0xFF);
+			}
+		}
+
+		// Hand the image back before touching the disk
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_FreeImages.push_back(frame.Image);
+		}
+		m_ImageAvailable.notify_one();
+
+		// Frames still queued behind a failed write are dropped, the sequence is incomplete either way
+		if (m_Failed)
+			continue;
+
+		char path[16];
+		snprintf(path, sizeof(path), "%04u.ppm", frame.FrameIndex);
+
+		std::FILE* file = std::fopen((specification.OutputPrefix + path).c_str(), "wb");
+		bool written = file && std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+		if (file)
+		{
+			written &= std::fclose(file) == 0;
+		}
+
+		if (!written)
+		{
+			m_Failed = true;
+		}
+		else if (status)
+		{
+			status->FramesDone++;
+		}
+	}
+}
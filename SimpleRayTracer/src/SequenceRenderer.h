@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Camera.h"
+#include "Scene.h"
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+/*
+*		Headless camera path renderer
+*		* Frame N+1 is prepared (keyframes evaluated, scene copied) while frame N is traced
+*		* Frame N-1 is encoded and written by an I/O thread through a bounded queue of reused buffers
+*/
+
+struct CameraKeyframe
+{
+	float Time = 0.0f; // Seconds
+	glm::vec3 Position{ 0.0f, 0.0f, 6.0f };
+	glm::vec3 Direction{ 0.0f, 0.0f, -1.0f };
+};
+
+struct SphereKeyframe
+{
+	float Time = 0.0f;
+	uint32_t SphereIndex = 0;
+	glm::vec3 Position{ 0.0f, 0.0f, 0.0f };
+	float Radius = 0.5f;
+};
+
+struct MaterialKeyframe
+{
+	float Time = 0.0f;
+	uint32_t MaterialIndex = 0;
+	Material Properties;
+};
+
+class SequenceRenderer
+{
+public:
+	struct Specification
+	{
+		std::string OutputPrefix = "Sequence/Frame_"; // Frames are written as <prefix>0000.ppm
+		uint32_t Width = 1280, Height = 720;
+		uint32_t FrameCount = 120;
+		float FrameRate = 30.0f;
+		uint32_t SamplesPerPixel = 64;
+
+		std::vector<CameraKeyframe> CameraKeyframes;
+		std::vector<SphereKeyframe> SphereKeyframes;
+		std::vector<MaterialKeyframe> MaterialKeyframes;
+	};
+
+	struct Status
+	{
+		std::atomic<bool> Running{ false };
+		std::atomic<bool> Cancel{ false };
+		std::atomic<uint32_t> FramesDone{ 0 };
+		std::atomic<uint32_t> FrameCount{ 0 };
+	};
+
+public:
+	SequenceRenderer() = default;
+
+	// Blocks until every frame is written, returns false if a frame could not be written
+	bool Render(const Scene& scene, const Camera& camera, const Specification& specification, Status* status = nullptr);
+
+	Renderer::Settings& GetSettings() { return m_Renderer.GetSettings(); }
+
+private:
+	struct Frame
+	{
+		Scene FrameScene;
+		Camera FrameCamera{ 45.0f, 0.1f, 100.0f };
+	};
+
+	struct EncodedFrame
+	{
+		uint32_t FrameIndex;
+		std::vector<uint32_t>* Image;
+	};
+
+	static Frame PrepareFrame(const Scene& scene, const Camera& camera, const Specification& specification, uint32_t frameIndex);
+	void WriterThread(const Specification& specification, Status* status);
+
+private:
+	Renderer m_Renderer;
+	std::vector<glm::vec4> m_Accumulation;
+
+	// Bounded queue between the tracer and the I/O thread
+	static constexpr uint32_t QueueDepth = 2;
+	std::vector<std::vector<uint32_t>> m_Images;
+	std::vector<std::vector<uint32_t>*> m_FreeImages;
+	std::deque<EncodedFrame> m_Pending;
+	bool m_Closing = false;
+	std::atomic<bool> m_Failed{ false };
+
+	std::mutex m_Mutex;
+	std::condition_variable m_ImageAvailable;
+	std::condition_variable m_FrameAvailable;
+};
@@ -0,0 +1,150 @@
+#include "TileWriter.h"
+
+#include <cstring>
+
+TileWriter::~TileWriter()
+{
+	if (m_File)
+	{
+		Close();
+	}
+}
+
+bool TileWriter::Open(const std::string& path, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t bufferCount)
+{
+	m_File = std::fopen(path.c_str(), "wb");
+	if (!m_File)
+		return false;
+
+	m_Header = Header();
+	m_Header.Width = width;
+	m_Header.Height = height;
+	m_Header.TileSize = tileSize;
+	m_Header.TilesX = (width + tileSize - 1) / tileSize;
+	m_Header.TilesY = (height + tileSize - 1) / tileSize;
+
+	m_Index.assign(GetTileCount(), IndexEntry());
+	m_Failed = false;
+	m_Closing = false;
+
+	// Placeholder header, rewritten with the index offset on Close
+	if (std::fwrite(&m_Header, sizeof(Header), 1, m_File) != 1)
+		m_Failed = true;
+	m_WriteOffset = sizeof(Header);
+
+	m_Staging.clear();
+	m_Staging.reserve(StagingSize);
+
+	m_Buffers.assign(bufferCount, std::vector<uint32_t>(tileSize * tileSize));
+	m_FreeBuffers.clear();
+	for (std::vector<uint32_t>& buffer : m_Buffers)
+	{
+		m_FreeBuffers.push_back(&buffer);
+	}
+
+	m_Thread = std::thread(&TileWriter::WriterThread, this);
+	return true;
+}
+
+bool TileWriter::Close(bool complete)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Closing = true;
+	}
+	m_TileAvailable.notify_one();
+	m_Thread.join();
+
+	FlushStaging();
+
+	// Index goes after the last tile, then the header is patched to point at it
+	if (complete && !m_Failed)
+	{
+		m_Header.IndexOffset = m_WriteOffset;
+		if (std::fwrite(m_Index.data(), sizeof(IndexEntry), m_Index.size(), m_File) != m_Index.size())
+			m_Failed = true;
+		if (std::fseek(m_File, 0, SEEK_SET) != 0)
+			m_Failed = true;
+		if (!m_Failed && std::fwrite(&m_Header, sizeof(Header), 1, m_File) != 1)
+			m_Failed = true;
+	}
+	if (std::fclose(m_File) != 0)
+		m_Failed = true;
+	m_File = nullptr;
+
+	m_Buffers.clear();
+	m_FreeBuffers.clear();
+	m_Staging = std::vector<uint8_t>();
+
+	return complete && !m_Failed;
+}
+
+std::vector<uint32_t>* TileWriter::AcquireBuffer()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_BufferAvailable.wait(lock, [this]() { return !m_FreeBuffers.empty(); });
+
+	std::vector<uint32_t>* buffer = m_FreeBuffers.back();
+	m_FreeBuffers.pop_back();
+	return buffer;
+}
+
+void TileWriter::Submit(uint32_t tileIndex, uint32_t width, uint32_t height, std::vector<uint32_t>* buffer)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Pending.push_back({ tileIndex, width, height, buffer });
+	}
+	m_TileAvailable.notify_one();
+}
+
+void TileWriter::WriterThread()
+{
+	while (true)
+	{
+		PendingTile tile;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_TileAvailable.wait(lock, [this]() { return !m_Pending.empty() || m_Closing; });
+
+			if (m_Pending.empty())
+				return;
+
+			tile = m_Pending.front();
+			m_Pending.pop_front();
+		}
+
+		size_t tileBytes = (size_t)tile.Width * tile.Height * sizeof(uint32_t);
+		if (m_Staging.size() + tileBytes > StagingSize)
+		{
+			FlushStaging();
+		}
+
+		IndexEntry& entry = m_Index[tile.TileIndex];
+		entry.Offset = m_WriteOffset + m_Staging.size();
+		entry.Width = tile.Width;
+		entry.Height = tile.Height;
+
+		size_t offset = m_Staging.size();
+		m_Staging.resize(offset + tileBytes);
+		memcpy(m_Staging.data() + offset, tile.Buffer->data(), tileBytes);
+
+		// Hand the buffer back to the render workers
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_FreeBuffers.push_back(tile.Buffer);
+		}
+		m_BufferAvailable.notify_one();
+	}
+}
+
+void TileWriter::FlushStaging()
+{
+	if (m_Staging.empty())
+		return;
+
+	if (std::fwrite(m_Staging.data(), 1, m_Staging.size(), m_File) != m_Staging.size())
+		m_Failed = true;
+	m_WriteOffset += m_Staging.size();
+	m_Staging.clear();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+/*
+*		Tile container (.srtc)
+*		* Header | tile payloads (RGBA8, in completion order) | tile index
+*		* The index holds one { offset, width, height } entry per tile in row-major tile order
+*		* Tiles are written by a background thread in large sequential chunks
+*/
+
+class TileWriter
+{
+public:
+	struct Header
+	{
+		char Magic[4] = { 'S', 'R', 'T', 'C' };
+		uint32_t Version = 1;
+		uint32_t Width = 0, Height = 0;
+		uint32_t TileSize = 0;
+		uint32_t TilesX = 0, TilesY = 0;
+		uint32_t Reserved = 0;
+		uint64_t IndexOffset = 0; // 0 while the file is incomplete
+	};
+
+	struct IndexEntry
+	{
+		uint64_t Offset = 0; // 0 = tile missing
+		uint32_t Width = 0, Height = 0;
+	};
+
+public:
+	TileWriter() = default;
+	~TileWriter();
+
+	// bufferCount bounds the number of finished tiles waiting to be written
+	bool Open(const std::string& path, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t bufferCount);
+	// An incomplete file (cancelled render) keeps IndexOffset at 0 so readers reject it
+	bool Close(bool complete = true);
+
+	// Blocks until a tile buffer is free (backpressure on the render workers)
+	std::vector<uint32_t>* AcquireBuffer();
+	void Submit(uint32_t tileIndex, uint32_t width, uint32_t height, std::vector<uint32_t>* buffer);
+
+	uint32_t GetTileCount() const { return m_Header.TilesX * m_Header.TilesY; }
+	bool HasFailed() const { return m_Failed; }
+
+private:
+	struct PendingTile
+	{
+		uint32_t TileIndex;
+		uint32_t Width, Height;
+		std::vector<uint32_t>* Buffer;
+	};
+
+	void WriterThread();
+	void FlushStaging();
+
+private:
+	std::FILE* m_File = nullptr;
+	Header m_Header;
+	std::vector<IndexEntry> m_Index;
+	uint64_t m_WriteOffset = 0;
+	std::atomic<bool> m_Failed{ false };
+
+	// Tiles are batched here so the disk sees few, large writes
+	static constexpr size_t StagingSize = 16 * 1024 * 1024;
+	std::vector<uint8_t> m_Staging;
+
+	std::vector<std::vector<uint32_t>> m_Buffers;
+	std::vector<std::vector<uint32_t>*> m_FreeBuffers;
+	std::deque<PendingTile> m_Pending;
+	bool m_Closing = false;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_BufferAvailable;
+	std::condition_variable m_TileAvailable;
+	std::thread m_Thread;
+};
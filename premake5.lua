@@ -7,4 +7,5 @@ workspace "SimpleRayTracer"
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 include "Walnut/WalnutExternal.lua"
 
-include "SimpleRayTracer"
\ No newline at end of file
+include "SimpleRayTracer"
+include "RenderDaemon"
\ No newline at end of file
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Root mean square error between two binary PPM (P6) images.
+
+Compares a render against a high sample count reference, e.g. to measure
+how much noise the radiance cache removes for the same number of samples:
+
+    RenderClient --scene scenes/Room.txt --width 160 --height 120 --spp 1024 --output Reference.ppm
+    RenderClient --scene scenes/Room.txt --width 160 --height 120 --spp 64 --cache 1 --output Cached.ppm
+    python scripts/ImageError.py Reference.ppm Cached.ppm
+"""
+
+import argparse
+import math
+import sys
+
+
+def read_ppm(path):
+    with open(path, "rb") as file:
+        data = file.read()
+
+    # Header is four whitespace separated tokens: P6 width height maxval
+    tokens = []
+    position = 0
+    while len(tokens) < 4:
+        while data[position:position + 1].isspace():
+            position += 1
+        start = position
+        while not data[position:position + 1].isspace():
+            position += 1
+        tokens.append(data[start:position])
+    position += 1
+
+    if tokens[0] != b"P6" or int(tokens[3]) != 255:
+        raise ValueError(f"{path} is not an 8-bit binary PPM")
+    width, height = int(tokens[1]), int(tokens[2])
+    return width, height, data[position:position + width * height * 3]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("reference")
+    parser.add_argument("image")
+    options = parser.parse_args()
+
+    try:
+        reference = read_ppm(options.reference)
+        image = read_ppm(options.image)
+    except (OSError, ValueError) as error:
+        print(error, file=sys.stderr)
+        return 1
+
+    if reference[:2] != image[:2]:
+        print(f"size mismatch: {reference[0]}x{reference[1]} and {image[0]}x{image[1]}", file=sys.stderr)
+        return 1
+
+    squared = sum((a - b) * (a - b) for a, b in zip(reference[2], image[2]))
+    print(f"rmse {math.sqrt(squared / len(reference[2])) / 255.0:.4f}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Load test for the render daemon.
+
+Starts several RenderClient processes at once, each sending a number of
+render requests over its own connection, then prints the client-side
+latencies and the throughput the daemon reports.
+
+    python scripts/LoadTest.py --client bin/Release-windows-x86_64/RenderClient/RenderClient.exe --clients 8 --requests 4
+
+--views N makes every request a batch of N views (a turntable around the
+y axis) rendered in one pass, e.g. compare many small views against one
+large image of the same pixel count:
+
+    python scripts/LoadTest.py --client RenderClient --clients 1 --requests 8 --width 64 --height 64 --views 64
+    python scripts/LoadTest.py --client RenderClient --clients 1 --requests 8 --width 512 --height 512
+"""
+
+import argparse
+import re
+import statistics
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+
+def run_client(arguments):
+    result = subprocess.run(arguments, capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(result.stderr.strip() or "client failed")
+    return result.stdout.splitlines()
+
+
+def field(line, key):
+    match = re.search(r"\b" + key + r"=([0-9.]+)", line)
+    return float(match.group(1)) if match else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--client", required=True, help="path to the RenderClient executable")
+    parser.add_argument("--socket", default="raytracer.sock")
+    parser.add_argument("--clients", type=int, default=4, help="concurrent connections")
+    parser.add_argument("--requests", type=int, default=4, help="requests per connection")
+    parser.add_argument("--scene", default="default")
+    parser.add_argument("--width", type=int, default=256)
+    parser.add_argument("--height", type=int, default=256)
+    parser.add_argument("--spp", type=int, default=16)
+    parser.add_argument("--views", type=int, default=1, help="views per request, rendered as one batch")
+    parser.add_argument("--high-priority-every", type=int, default=0,
+                        help="give every Nth connection priority 1 to exercise preemption")
+    options = parser.parse_args()
+
+    def command(index):
+        priority = 1 if options.high_priority_every and index % options.high_priority_every == 0 else 0
+        return [options.client, "--socket", options.socket, "--scene", options.scene,
+                "--width", str(options.width), "--height", str(options.height), "--spp", str(options.spp),
+                "--views", str(options.views),
+                "--priority", str(priority), "--count", str(options.requests)]
+
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=options.clients) as pool:
+        try:
+            results = list(pool.map(run_client, [command(i) for i in range(options.clients)]))
+        except RuntimeError as error:
+            print(f"Client failed: {error}", file=sys.stderr)
+            return 1
+    elapsed = time.perf_counter() - start
+
+    lines = [line for output in results for line in output]
+    round_trips = sorted(field(line, "round_trip_ms") for line in lines)
+    queue_times = [field(line, "queue_ms") for line in lines]
+    render_times = [field(line, "render_ms") for line in lines]
+    preemptions = sum(int(field(line, "preemptions")) for line in lines)
+
+    samples = len(lines) * options.width * options.height * options.views * options.spp
+    print(f"{len(lines)} jobs in {elapsed:.2f} s, {len(lines) / elapsed:.2f} jobs/s, "
+          f"{samples / sum(render_times) / 1000.0:.2f} M samples/s while rendering")
+    print(f"round trip ms: median {statistics.median(round_trips):.1f}, "
+          f"p95 {round_trips[int(0.95 * (len(round_trips) - 1))]:.1f}, max {round_trips[-1]:.1f}")
+    print(f"queue ms: mean {statistics.mean(queue_times):.1f}, render ms: mean {statistics.mean(render_times):.1f}, "
+          f"preemptions: {preemptions}")
+
+    print("daemon: " + " ".join(run_client([options.client, "--socket", options.socket, "--stats"])))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())